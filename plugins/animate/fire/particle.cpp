@@ -1,7 +1,6 @@
 #include "particle.hpp"
 #include "shaders.hpp"
 #include <core.hpp>
-#include <thread>
 #include <debug.hpp>
 
 void Particle::update(float time)
@@ -47,7 +46,7 @@ ParticleSystem::ParticleSystem(int particles, ParticleIniter init_func)
 ParticleSystem::~ParticleSystem()
 {
     OpenGL::render_begin();
-    GL_CALL(glDeleteProgram(program.id));
+    OpenGL::destroy_program(program.id);
     OpenGL::render_end();
 }
 
@@ -96,6 +95,9 @@ int ParticleSystem::size()
 void ParticleSystem::update_worker(float time, int start, int end)
 {
     end = std::min(end, (int)ps.size());
+
+    /* Update the shared counter once per range */
+    int died = 0;
     for (int i = start; i < end; ++i)
     {
         if (ps[i].life <= 0)
@@ -105,7 +107,7 @@ void ParticleSystem::update_worker(float time, int start, int end)
         ps[i].update(time);
 
         if (ps[i].life <= 0)
-            --particles_alive;
+            ++died;
 
         for (int j = 0; j < 4; j++) // maybe use memcpy?
         {
@@ -119,27 +121,9 @@ void ParticleSystem::update_worker(float time, int start, int end)
 
         radius[i] = ps[i].radius;
     }
-}
-
-void ParticleSystem::exec_worker_threads(std::function<void(int, int)> spawn_worker)
-{
-//    return spawn_worker(0, ps.size());
-
-    const int num_threads = std::thread::hardware_concurrency();
-    const int worker_load = (ps.size() + num_threads - 1) / num_threads;
-
-    std::thread workers[num_threads];
-    for (int i = 0; i < num_threads; i++)
-    {
-        int thread_start = i * worker_load;
-        int thread_end = (i + 1) * worker_load;
-        thread_end = std::min(thread_end, (int)ps.size());
-
-        workers[i] = std::thread([=] () { spawn_worker(thread_start, thread_end); });
-    }
 
-    for (auto& w : workers)
-        w.join();
+    if (died)
+        particles_alive -= died;
 }
 
 void ParticleSystem::update()
@@ -148,7 +132,9 @@ void ParticleSystem::update()
     float time = (get_current_time() - last_update_msec) / 16.0;
     last_update_msec = get_current_time();
 
-    exec_worker_threads([=] (int start, int end) {
+    /* Small ranges, so that the workers which start late still get a share */
+    const int grain = 256;
+    core->thread_pool->parallel_for(0, ps.size(), grain, [=] (int start, int end) {
         update_worker(time, start, end);
     });
 }
@@ -163,7 +149,7 @@ void ParticleSystem::create_program()
     /* Just load the proper context, viewport doesn't matter */
     OpenGL::render_begin();
 
-    program.id = OpenGL::create_program_from_source(particle_vert_source,
+    program.id = OpenGL::create_shared_program_from_source(particle_vert_source,
         particle_frag_source);
 
     program.radius    = GL_CALL(glGetAttribLocation(program.id, "radius"));
@@ -84,7 +84,6 @@ class ParticleSystem
             GLuint matrix;
         } program;
 
-        void exec_worker_threads(std::function<void(int, int)> spawn_worker);
         void update_worker(float time, int start, int end);
         void create_program();
 };
@@ -55,7 +55,7 @@ wf_blur_base::wf_blur_base(wayfire_output *output,
     this->iterations_opt->add_updated_handler(&options_changed);
 
     OpenGL::render_begin();
-    blend_program = OpenGL::create_program_from_source(
+    blend_program = OpenGL::create_shared_program_from_source(
         blur_blend_vertex_shader, blur_blend_fragment_shader);
 
     blend_posID    = GL_CALL(glGetAttribLocation(blend_program, "position"));
@@ -76,9 +76,9 @@ wf_blur_base::~wf_blur_base()
     OpenGL::render_begin();
     fb[0].release();
     fb[1].release();
-    GL_CALL(glDeleteProgram(program[0]));
-    GL_CALL(glDeleteProgram(program[1]));
-    GL_CALL(glDeleteProgram(blend_program));
+    OpenGL::destroy_program(program[0]);
+    OpenGL::destroy_program(program[1]);
+    OpenGL::destroy_program(blend_program);
     OpenGL::render_end();
 }
 
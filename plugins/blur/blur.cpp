@@ -237,16 +237,9 @@ class wayfire_blur : public wayfire_plugin_t
              * be no visual artifacts. */
             int padding = blur_algorithm->calculate_blur_radius();
 
-            wf_region expanded_damage;
-            for (const auto& rect : damage)
-            {
-                expanded_damage |= {
-                    rect.x1 - padding,
-                    rect.y1 - padding,
-                    (rect.x2 - rect.x1) + 2 * padding,
-                    (rect.y2 - rect.y1) + 2 * padding
-                };
-            }
+            /* Expand each damaged rect by the padding */
+            wf_region expanded_damage = damage;
+            expanded_damage.expand_edges(padding);
 
             /* Keep rects on screen */
             expanded_damage &= output->render->get_damage_box();
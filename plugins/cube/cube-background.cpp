@@ -0,0 +1,105 @@
+#include "cube-background.hpp"
+#include <debug.hpp>
+#include <map>
+
+namespace
+{
+    using texture_key_t = std::pair<std::string, GLenum>;
+    std::map<texture_key_t, std::weak_ptr<wf_cube_background_texture>> textures;
+}
+
+std::shared_ptr<wf_cube_background_texture> wf_cube_background_texture::get(
+    const std::string& path, GLenum target)
+{
+    texture_key_t key{path, target};
+    auto it = textures.find(key);
+    if (it != textures.end())
+    {
+        if (auto texture = it->second.lock())
+            return texture;
+    }
+
+    std::shared_ptr<wf_cube_background_texture> texture(
+        new wf_cube_background_texture(path, target));
+    textures[key] = texture;
+
+    return texture;
+}
+
+wf_cube_background_texture::wf_cube_background_texture(const std::string& path,
+    GLenum target)
+{
+    this->path = path;
+    this->target = target;
+
+    on_image_ready = [=] () { upload(); };
+    image = image_io::load_async(path);
+    image.add_ready_callback(&on_image_ready);
+}
+
+wf_cube_background_texture::~wf_cube_background_texture()
+{
+    image.rem_ready_callback(&on_image_ready);
+
+    auto it = textures.find({path, target});
+    if (it != textures.end() && it->second.expired())
+        textures.erase(it);
+
+    if (tex == (uint32_t)-1)
+        return;
+
+    OpenGL::render_begin();
+    GL_CALL(glDeleteTextures(1, &tex));
+    OpenGL::render_end();
+}
+
+bool wf_cube_background_texture::loading() const
+{
+    return image.valid();
+}
+
+GLuint wf_cube_background_texture::get_texture() const
+{
+    return tex;
+}
+
+void wf_cube_background_texture::upload()
+{
+    OpenGL::render_begin();
+    GL_CALL(glGenTextures(1, &tex));
+    GL_CALL(glBindTexture(target, tex));
+
+    /* A cubemap shows the same image on each face */
+    int faces = (target == GL_TEXTURE_CUBE_MAP ? 6 : 1);
+    GLenum first_face = (target == GL_TEXTURE_CUBE_MAP ?
+        GL_TEXTURE_CUBE_MAP_POSITIVE_X : target);
+
+    bool uploaded = true;
+    for (int i = 0; i < faces && uploaded; i++)
+        uploaded = image.upload(first_face + i);
+
+    if (uploaded)
+    {
+        GL_CALL(glGenerateMipmap(target));
+        GL_CALL(glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+        GL_CALL(glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            GL_CALL(glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+        }
+    } else
+    {
+        log_error("cube: failed to load background image from \"%s\".",
+            path.c_str());
+        GL_CALL(glDeleteTextures(1, &tex));
+        tex = -1;
+    }
+
+    GL_CALL(glBindTexture(target, 0));
+    OpenGL::render_end();
+
+    /* The pixels aren't needed anymore */
+    image = {};
+}
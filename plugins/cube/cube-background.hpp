@@ -2,6 +2,8 @@
 #define WF_CUBE_BACKGROUND_HPP
 
 #include <opengl.hpp>
+#include <img.hpp>
+#include <memory>
 #include "cube.hpp"
 
 class wf_cube_background_base
@@ -12,4 +14,33 @@ class wf_cube_background_base
     virtual ~wf_cube_background_base() = default;
 };
 
+/* A background texture loaded from an image file. The image is decoded once,
+ * in the background, and the texture is mipmapped on the GPU. All outputs
+ * which use the same file for the same target share the texture. */
+class wf_cube_background_texture
+{
+    public:
+    /* target is GL_TEXTURE_2D, or GL_TEXTURE_CUBE_MAP for a cubemap which
+     * has the image on each face */
+    static std::shared_ptr<wf_cube_background_texture> get(
+        const std::string& path, GLenum target);
+    ~wf_cube_background_texture();
+
+    /* Whether the image is still being decoded */
+    bool loading() const;
+    /* The texture, or -1 while decoding or if the image couldn't be loaded */
+    GLuint get_texture() const;
+
+    private:
+    wf_cube_background_texture(const std::string& path, GLenum target);
+    void upload();
+
+    std::string path;
+    GLenum target;
+    GLuint tex = -1;
+
+    image_io::image_future_t image;
+    image_io::image_callback_t on_image_ready;
+};
+
 #endif /* end of include guard: WF_CUBE_BACKGROUND_HPP */
@@ -32,6 +32,9 @@ class wayfire_cube : public wayfire_plugin_t
     wf_point saved_pointer_position;
 
     std::vector<std::unique_ptr<wf_workspace_stream>> streams;
+    /* The scale of each side of the cube in the current frame, 0 for hidden
+     * sides. Indexed by the side, not by the workspace */
+    std::vector<float> face_scales;
 
     wf_option XVelocity, YVelocity, ZVelocity;
     wf_option zoom_opt;
@@ -169,7 +172,6 @@ class wayfire_cube : public wayfire_plugin_t
         std::string ext_string(reinterpret_cast<const char*> (glGetString(GL_EXTENSIONS)));
         tessellation_support =
             ext_string.find(std::string("GL_EXT_tessellation_shader")) != std::string::npos;
-        GLuint tcs = -1, tes = -1, gss = -1;
 #else
         tessellation_support = false;
 #endif
@@ -181,43 +183,27 @@ class wayfire_cube : public wayfire_plugin_t
             shaderSrcPath = INSTALL_PREFIX "/share/wayfire/cube/shaders_2.0";
         }
 
-        program.id = GL_CALL(glCreateProgram());
-        GLuint vss, fss;
-
         /* Vertex and fragment shaders are used in both GLES 2.0 and 3.2 modes */
-        vss = OpenGL::load_shader(shaderSrcPath + "/vertex.glsl", GL_VERTEX_SHADER);
-        fss = OpenGL::load_shader(shaderSrcPath + "/frag.glsl", GL_FRAGMENT_SHADER);
-        GL_CALL(glAttachShader(program.id, vss));
-        GL_CALL(glAttachShader(program.id, fss));
+        std::vector<OpenGL::shader_stage_t> stages = {
+            {GL_VERTEX_SHADER, OpenGL::read_shader_source(shaderSrcPath + "/vertex.glsl")},
+            {GL_FRAGMENT_SHADER, OpenGL::read_shader_source(shaderSrcPath + "/frag.glsl")},
+        };
 
         if (tessellation_support)
         {
 #ifdef USE_GLES32
-            tcs = OpenGL::load_shader(shaderSrcPath + "/tcs.glsl", GL_TESS_CONTROL_SHADER);
-            tes = OpenGL::load_shader(shaderSrcPath + "/tes.glsl", GL_TESS_EVALUATION_SHADER);
-            gss = OpenGL::load_shader(shaderSrcPath + "/geom.glsl", GL_GEOMETRY_SHADER);
-
-            GL_CALL(glAttachShader(program.id, tcs));
-            GL_CALL(glAttachShader(program.id, tes));
-            GL_CALL(glAttachShader(program.id, gss));
+            stages.push_back({GL_TESS_CONTROL_SHADER,
+                OpenGL::read_shader_source(shaderSrcPath + "/tcs.glsl")});
+            stages.push_back({GL_TESS_EVALUATION_SHADER,
+                OpenGL::read_shader_source(shaderSrcPath + "/tes.glsl")});
+            stages.push_back({GL_GEOMETRY_SHADER,
+                OpenGL::read_shader_source(shaderSrcPath + "/geom.glsl")});
 #endif
         }
 
-        GL_CALL(glLinkProgram(program.id));
+        program.id = OpenGL::create_shared_program_from_stages(stages);
         GL_CALL(glUseProgram(program.id));
 
-        GL_CALL(glDeleteShader(vss));
-        GL_CALL(glDeleteShader(fss));
-
-        if (tessellation_support)
-        {
-#ifdef USE_GLES32
-            GL_CALL(glDeleteShader(tcs));
-            GL_CALL(glDeleteShader(tes));
-            GL_CALL(glDeleteShader(gss));
-#endif
-        }
-
         program.vpID = GL_CALL(glGetUniformLocation(program.id, "VP"));
         program.uvID = GL_CALL(glGetAttribLocation(program.id, "uvPosition"));
         program.posID = GL_CALL(glGetAttribLocation(program.id, "position"));
@@ -388,20 +374,129 @@ class wayfire_cube : public wayfire_plugin_t
         animation.view = zoom_translate * rotation * view;
     }
 
+    /* Returns the transform from the i-th side of the cube to view space,
+     * without the output transform, which doesn't change what is visible */
+    glm::mat4 calculate_face_view_matrix(int i)
+    {
+        float zoom_factor = animation.duration.progress(animation.zoom);
+        auto scale_matrix = glm::scale(glm::mat4(1.0),
+            glm::vec3(1. / zoom_factor, 1. / zoom_factor, 1. / zoom_factor));
+
+        return animation.view * scale_matrix *
+            calculate_model_matrix(i, glm::mat4(1.0));
+    }
+
+    /* Whether the outer side of the i-th side of the cube faces the camera */
+    bool is_facing_camera(int i)
+    {
+        auto face = calculate_face_view_matrix(i);
+        glm::vec3 center = face * glm::vec4(0, 0, 0, 1);
+        glm::vec3 normal = face * glm::vec4(0, 0, 1, 0);
+
+        /* The camera is at the origin */
+        return glm::dot(normal, -center) > 0;
+    }
+
+    /* Returns the size of the given side of the cube on the screen relative to
+     * the output, or 0 if the side can't be seen in the next frame */
+    float get_face_scale(int i, bool camera_inside)
+    {
+        /* Sides are opaque, so from the outside only the sides facing the
+         * camera are visible, and from the inside only the others.
+         *
+         * The deformation bends the sides, so then sides which are turned
+         * away may still peek out behind the front ones */
+        bool deformed = tessellation_support && use_deform->as_cached_int();
+        if (!deformed && is_facing_camera(i) == camera_inside)
+            return 0;
+
+        static const glm::vec4 corners[] = {
+            {-0.5, -0.5, 0, 1}, {0.5, -0.5, 0, 1},
+            {0.5, 0.5, 0, 1}, {-0.5, 0.5, 0, 1},
+        };
+
+        auto face = animation.projection * calculate_face_view_matrix(i);
+        glm::vec4 clip[4];
+        for (int j = 0; j < 4; j++)
+            clip[j] = face * corners[j];
+
+        /* Outside of the view frustum, if all corners are on the outer side
+         * of the same frustum plane */
+        for (int axis = 0; axis < 3; axis++)
+        {
+            bool all_below = true, all_above = true;
+            for (int j = 0; j < 4; j++)
+            {
+                all_below &= clip[j][axis] < -clip[j].w;
+                all_above &= clip[j][axis] > clip[j].w;
+            }
+
+            if (all_below || all_above)
+                return 0;
+        }
+
+        /* A side partially behind the camera covers most of the screen */
+        float min_x = 1, max_x = -1, min_y = 1, max_y = -1;
+        for (int j = 0; j < 4; j++)
+        {
+            if (clip[j].w <= 0)
+                return 1;
+
+            min_x = std::min(min_x, clip[j].x / clip[j].w);
+            max_x = std::max(max_x, clip[j].x / clip[j].w);
+            min_y = std::min(min_y, clip[j].y / clip[j].w);
+            max_y = std::max(max_y, clip[j].y / clip[j].w);
+        }
+
+        /* The output spans 2 units in NDC. The stream uses a single scale
+         * for both axes, so use the larger one to avoid blurring the side */
+        float scale = std::max(max_x - min_x, max_y - min_y) / 2;
+        return clamp(scale, 0.01f, 1.0f);
+    }
+
     void update_workspace_streams()
     {
         GetTuple(vx, vy, output->workspace->get_current_workspace());
-        (void) vx;
 
-        for(size_t i = 0; i < streams.size(); i++)
+        int n = streams.size();
+        face_scales.assign(n, 1);
+
+        /* With less than 3 workspaces, the sides don't form a closed prism */
+        if (n >= 3)
+        {
+            /* The camera is inside the cube if no side faces it */
+            bool camera_inside = true;
+            for (int i = 0; i < n; i++)
+                camera_inside &= !is_facing_camera(i);
+
+            for (int i = 0; i < n; i++)
+                face_scales[i] = get_face_scale(i, camera_inside);
+        }
+
+        for (int i = 0; i < n; i++)
         {
+            /* The side on which the i-th workspace is shown */
+            float scale = face_scales[(i - vx + n) % n];
+
+            /* Hidden sides keep their last contents. Damage isn't tracked
+             * while they are hidden, so they get a full repaint when they
+             * are visible again */
+            if (scale <= 0)
+            {
+                if (streams[i]->running)
+                    output->render->workspace_stream_stop(streams[i].get());
+                continue;
+            }
+
             if (!streams[i]->running)
             {
                 streams[i]->ws = std::make_tuple(i, vy);
-                output->render->workspace_stream_start(streams[i].get());
+                output->render->workspace_stream_start(streams[i].get(),
+                    scale, scale);
             } else
             {
-                output->render->workspace_stream_update(streams[i].get());
+                output->render->workspace_stream_update(streams[i].get(),
+                    scale, scale);
             }
         }
     }
@@ -436,6 +531,10 @@ class wayfire_cube : public wayfire_plugin_t
         (void) vy;
         for(size_t i = 0; i < streams.size(); i++)
         {
+            /* Not visible, and the stream might have never been rendered */
+            if (i < face_scales.size() && face_scales[i] <= 0)
+                continue;
+
             int index = (vx + i) % streams.size();
             GL_CALL(glBindTexture(GL_TEXTURE_2D, streams[index]->buffer.tex));
 
@@ -584,6 +683,7 @@ class wayfire_cube : public wayfire_plugin_t
         OpenGL::render_begin();
         for (size_t i = 0; i < streams.size(); i++)
             streams[i]->buffer.release();
+        OpenGL::destroy_program(program.id);
         OpenGL::render_end();
 
         output->rem_binding(&activate_binding);
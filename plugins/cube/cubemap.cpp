@@ -5,11 +5,51 @@
 #include <debug.hpp>
 #include <config.h>
 #include <core.hpp>
-#include <img.hpp>
+
+#include "cubemap-vertex-data.hpp"
+
+/* The vertices of the skybox, in a buffer shared by all outputs */
+struct wf_cube_cubemap_mesh
+{
+    GLuint vbo;
+
+    wf_cube_cubemap_mesh()
+    {
+        OpenGL::render_begin();
+        GL_CALL(glGenBuffers(1, &vbo));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, vbo));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices),
+                skyboxVertices, GL_STATIC_DRAW));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        OpenGL::render_end();
+    }
+
+    ~wf_cube_cubemap_mesh()
+    {
+        OpenGL::render_begin();
+        GL_CALL(glDeleteBuffers(1, &vbo));
+        OpenGL::render_end();
+    }
+
+    static std::shared_ptr<wf_cube_cubemap_mesh> get()
+    {
+        static std::weak_ptr<wf_cube_cubemap_mesh> shared;
+
+        auto mesh = shared.lock();
+        if (!mesh)
+        {
+            mesh = std::make_shared<wf_cube_cubemap_mesh> ();
+            shared = mesh;
+        }
+
+        return mesh;
+    }
+};
 
 wf_cube_background_cubemap::wf_cube_background_cubemap()
 {
     create_program();
+    mesh = wf_cube_cubemap_mesh::get();
 
     background_image = (*core->config)["cube"]->get_option("cubemap_image", "");
     reload_texture();
@@ -18,7 +58,7 @@ wf_cube_background_cubemap::wf_cube_background_cubemap()
 wf_cube_background_cubemap::~wf_cube_background_cubemap()
 {
     OpenGL::render_begin();
-    GL_CALL(glDeleteProgram(program));
+    OpenGL::destroy_program(program);
     OpenGL::render_end();
 }
 
@@ -27,7 +67,7 @@ void wf_cube_background_cubemap::create_program()
     OpenGL::render_begin();
 
     std::string shader_path = INSTALL_PREFIX "/share/wayfire/cube/shaders_2.0";
-    program = OpenGL::create_program(shader_path + "/vertex_cubemap.glsl",
+    program = OpenGL::create_shared_program(shader_path + "/vertex_cubemap.glsl",
         shader_path + "/frag_cubemap.glsl");
 
     posID =  GL_CALL(glGetAttribLocation(program, "position"));
@@ -38,56 +78,36 @@ void wf_cube_background_cubemap::create_program()
 
 void wf_cube_background_cubemap::reload_texture()
 {
-    if (last_background_image == background_image->as_string())
-        return;
-
-    last_background_image = background_image->as_string();
-
-    OpenGL::render_begin();
-    if (tex == (uint32_t)-1)
-    {
-        GL_CALL(glGenTextures(1, &tex));
-    }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
-    for (int i = 0; i < 6; i++)
+    if (last_background_image != background_image->as_string())
     {
-        if (!image_io::load_from_file(last_background_image, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i))
-        {
-            log_error("Failed to load cubemap background image from \"%s\".",
-                last_background_image.c_str());
-
-            GL_CALL(glDeleteTextures(1, &tex));
-            tex = -1;
-            break;
-        }
+        last_background_image = background_image->as_string();
+        next_texture = wf_cube_background_texture::get(
+            last_background_image, GL_TEXTURE_CUBE_MAP);
     }
 
-    if (tex != (uint32_t)-1)
+    /* The old texture is kept until the new image is decoded */
+    if (next_texture && !next_texture->loading())
     {
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE));
+        texture = std::move(next_texture);
+        next_texture = nullptr;
     }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, 0));
-    OpenGL::render_end();
 }
 
-#include "cubemap-vertex-data.hpp"
-
 void wf_cube_background_cubemap::render_frame(const wf_framebuffer& fb,
     wf_cube_animation_attribs& attribs)
 {
     reload_texture();
 
     OpenGL::render_begin(fb);
+    GLuint tex = texture ? texture->get_texture() : -1;
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
-        GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+        /* Still decoding */
+        if (!texture)
+            OpenGL::clear({0, 0, 0, 1});
+        else
+            OpenGL::clear({TEX_ERROR_FLAG_COLOR});
+        OpenGL::render_end();
         return;
     }
 
@@ -96,8 +116,9 @@ void wf_cube_background_cubemap::render_frame(const wf_framebuffer& fb,
 
     GL_CALL(glBindTexture(GL_TEXTURE_CUBE_MAP, tex));
 
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo));
     GL_CALL(glEnableVertexAttribArray(posID));
-    GL_CALL(glVertexAttribPointer(posID, 3, GL_FLOAT, GL_FALSE, 0, skyboxVertices));
+    GL_CALL(glVertexAttribPointer(posID, 3, GL_FLOAT, GL_FALSE, 0, 0));
 
     auto model = glm::rotate(glm::mat4(1.0),
         float(attribs.duration.progress(attribs.rotation) * 0.7f),
@@ -115,6 +136,7 @@ void wf_cube_background_cubemap::render_frame(const wf_framebuffer& fb,
     GL_CALL(glUniformMatrix4fv(matrixID, 1, GL_FALSE, &model[0][0]));
     GL_CALL(glDrawArrays(GL_TRIANGLES, 0, 6 * 6));
     GL_CALL(glDisableVertexAttribArray(posID));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
     GL_CALL(glDepthMask(GL_TRUE));
 
     OpenGL::render_end();
@@ -3,6 +3,7 @@
 
 #include "cube-background.hpp"
 
+struct wf_cube_cubemap_mesh;
 class wf_cube_background_cubemap : public wf_cube_background_base
 {
     public:
@@ -16,11 +17,15 @@ class wf_cube_background_cubemap : public wf_cube_background_base
     void reload_texture();
     void create_program();
 
-    GLuint program = -1, tex = -1;
+    GLuint program = -1;
     GLuint matrixID, posID;
 
     std::string last_background_image;
     wf_option background_image;
+
+    /* The texture which is shown, and the new one while it is decoded */
+    std::shared_ptr<wf_cube_background_texture> texture, next_texture;
+    std::shared_ptr<wf_cube_cubemap_mesh> mesh;
 };
 
 #endif /* end of include guard: WF_CUBE_CUBEMAP_HPP */
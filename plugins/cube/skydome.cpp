@@ -1,17 +1,117 @@
 #include "skydome.hpp"
 #include <debug.hpp>
 #include <core.hpp>
-#include <img.hpp>
 
 #include <output.hpp>
 #include <workspace-manager.hpp>
 
-
+#include <vector>
 #include <glm/gtc/matrix_transform.hpp>
 
 #define SKYDOME_GRID_WIDTH 128
 #define SKYDOME_GRID_HEIGHT 128
 
+/* The sphere of the skydome, in static buffers shared by all outputs. Only
+ * the texture coordinates depend on the mirror option. */
+struct wf_cube_skydome_mesh
+{
+    GLuint vbo_pos, vbo_uv, ibo;
+    GLsizei index_count;
+
+    wf_cube_skydome_mesh(bool mirror)
+    {
+        float scale = 75.0;
+        int gw = SKYDOME_GRID_WIDTH + 1;
+        int gh = SKYDOME_GRID_HEIGHT;
+
+        std::vector<GLfloat> vertices, coords;
+        /* (gh - 1) * gw vertices fit in 16 bit indices */
+        std::vector<GLushort> indices;
+
+        for (int i = 1; i < gh; i++)
+        {
+            for (int j = 0; j < gw; j++)
+            {
+                float theta = ((2 * M_PI) / (gw - 1)) * j;
+                float phi = (M_PI / gh) * i;
+
+                vertices.push_back(cos(theta) * sin(phi) * scale);
+                vertices.push_back(cos(phi) * scale);
+                vertices.push_back(sin(theta) * sin(phi) * scale);
+
+                if (!mirror)
+                {
+                    coords.push_back((float) j / (gw - 1));
+                    coords.push_back((float) (i - 1) / (gh - 2));
+                }
+                else
+                {
+                    float u = ((float) j / (gw - 1)) * 2.0;
+                    coords.push_back(u - ((u > 1.0) ? (2.0 * (u - 1.0)) : 0));
+                    coords.push_back((float) (i - 1) / (gh - 2));
+                }
+            }
+        }
+
+        for (int i = 1; i < gh - 1; i++)
+        {
+            for(int j = 0; j < gw - 1; j++)
+            {
+                indices.push_back((i - 1) * gw + j);
+                indices.push_back((i - 1) * gw + j + gw);
+                indices.push_back((i - 1) * gw + j + 1);
+                indices.push_back((i - 1) * gw + j + 1);
+                indices.push_back((i - 1) * gw + j + gw);
+                indices.push_back((i - 1) * gw + j + gw + 1);
+            }
+        }
+
+        index_count = indices.size();
+
+        OpenGL::render_begin();
+        GL_CALL(glGenBuffers(1, &vbo_pos));
+        GL_CALL(glGenBuffers(1, &vbo_uv));
+        GL_CALL(glGenBuffers(1, &ibo));
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, vbo_pos));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+                vertices.data(), GL_STATIC_DRAW));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, vbo_uv));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, coords.size() * sizeof(GLfloat),
+                coords.data(), GL_STATIC_DRAW));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo));
+        GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW));
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+        OpenGL::render_end();
+    }
+
+    ~wf_cube_skydome_mesh()
+    {
+        OpenGL::render_begin();
+        GL_CALL(glDeleteBuffers(1, &vbo_pos));
+        GL_CALL(glDeleteBuffers(1, &vbo_uv));
+        GL_CALL(glDeleteBuffers(1, &ibo));
+        OpenGL::render_end();
+    }
+
+    static std::shared_ptr<wf_cube_skydome_mesh> get(bool mirror)
+    {
+        static std::weak_ptr<wf_cube_skydome_mesh> shared[2];
+
+        auto mesh = shared[mirror].lock();
+        if (!mesh)
+        {
+            mesh = std::make_shared<wf_cube_skydome_mesh> (mirror);
+            shared[mirror] = mesh;
+        }
+
+        return mesh;
+    }
+};
+
 wf_cube_background_skydome::wf_cube_background_skydome(wayfire_output *output)
 {
     this->output = output;
@@ -19,13 +119,14 @@ wf_cube_background_skydome::wf_cube_background_skydome(wayfire_output *output)
 
     background_image = (*core->config)["cube"]->get_option("skydome_texture", "");
     mirror_opt = (*core->config)["cube"]->get_option("skydome_mirror", "1");
+
     reload_texture();
 }
 
 wf_cube_background_skydome::~wf_cube_background_skydome()
 {
     OpenGL::render_begin();
-    GL_CALL(glDeleteProgram(program));
+    OpenGL::destroy_program(program);
     OpenGL::render_end();
 }
 
@@ -35,7 +136,7 @@ void wf_cube_background_skydome::load_program()
 
     std::string shader_path = INSTALL_PREFIX "/share/wayfire/cube/shaders_2.0";
 
-    program = OpenGL::create_program(
+    program = OpenGL::create_shared_program(
         shader_path + "/vertex.glsl", shader_path + "/frag.glsl");
 
     vpID    = GL_CALL(glGetUniformLocation(program, "VP"));
@@ -48,103 +149,47 @@ void wf_cube_background_skydome::load_program()
 
 void wf_cube_background_skydome::reload_texture()
 {
-    if (last_background_image == background_image->as_string())
-        return;
-
-    last_background_image = background_image->as_string();
-    OpenGL::render_begin();
-
-    if (tex == (uint32_t)-1)
+    if (last_background_image != background_image->as_string())
     {
-        GL_CALL(glGenTextures(1, &tex));
+        last_background_image = background_image->as_string();
+        next_texture = wf_cube_background_texture::get(
+            last_background_image, GL_TEXTURE_2D);
     }
 
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-
-    if (image_io::load_from_file(last_background_image, GL_TEXTURE_2D))
-    {
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    }
-    else
+    /* The old texture is kept until the new image is decoded */
+    if (next_texture && !next_texture->loading())
     {
-        log_error("Failed to load skydome image from \"%s\".",
-            last_background_image.c_str());
-        GL_CALL(glDeleteTextures(1, &tex));
-        tex = -1;
+        texture = std::move(next_texture);
+        next_texture = nullptr;
     }
-
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
-
-    OpenGL::render_end();
 }
 
-void wf_cube_background_skydome::fill_vertices()
+void wf_cube_background_skydome::reload_mesh()
 {
-    if (mirror_opt->as_int() == last_mirror)
+    bool mirror = mirror_opt->as_int();
+    if (mirror == last_mirror)
         return;
 
-    last_mirror = mirror_opt->as_int();
-
-    float scale = 75.0;
-    int gw = SKYDOME_GRID_WIDTH + 1;
-    int gh = SKYDOME_GRID_HEIGHT;
-
-    vertices.clear();
-    indices.clear();
-    coords.clear();
-
-    for (int i = 1; i < gh; i++)
-    {
-        for (int j = 0; j < gw; j++)
-        {
-            float theta = ((2 * M_PI) / (gw - 1)) * j;
-            float phi = (M_PI / gh) * i;
-
-            vertices.push_back(cos(theta) * sin(phi) * scale);
-            vertices.push_back(cos(phi) * scale);
-            vertices.push_back(sin(theta) * sin(phi) * scale);
-
-            if (last_mirror == 0)
-            {
-                coords.push_back((float) j / (gw - 1));
-                coords.push_back((float) (i - 1) / (gh - 2));
-            }
-            else
-            {
-                float u = ((float) j / (gw - 1)) * 2.0;
-                coords.push_back(u - ((u > 1.0) ? (2.0 * (u - 1.0)) : 0));
-                coords.push_back((float) (i - 1) / (gh - 2));
-            }
-        }
-    }
-
-    for (int i = 1; i < gh - 1; i++)
-    {
-        for(int j = 0; j < gw - 1; j++)
-        {
-            indices.push_back((i - 1) * gw + j);
-            indices.push_back((i - 1) * gw + j + gw);
-            indices.push_back((i - 1) * gw + j + 1);
-            indices.push_back((i - 1) * gw + j + 1);
-            indices.push_back((i - 1) * gw + j + gw);
-            indices.push_back((i - 1) * gw + j + gw + 1);
-        }
-    }
+    last_mirror = mirror;
+    mesh = wf_cube_skydome_mesh::get(mirror);
 }
 
 void wf_cube_background_skydome::render_frame(const wf_framebuffer& fb,
         wf_cube_animation_attribs& attribs)
 {
-    fill_vertices();
+    reload_mesh();
     reload_texture();
 
+    GLuint tex = texture ? texture->get_texture() : -1;
     if (tex == (uint32_t)-1)
     {
-        GL_CALL(glClearColor(TEX_ERROR_FLAG_COLOR));
-        GL_CALL(glClear(GL_COLOR_BUFFER_BIT));
+        OpenGL::render_begin(fb);
+        /* Still decoding */
+        if (!texture)
+            OpenGL::clear({0, 0, 0, 1});
+        else
+            OpenGL::clear({TEX_ERROR_FLAG_COLOR});
+        OpenGL::render_end();
         return;
     }
 
@@ -167,8 +212,10 @@ void wf_cube_background_skydome::render_frame(const wf_framebuffer& fb,
 
     GL_CALL(glUniformMatrix4fv(vpID, 1, GL_FALSE, &vp[0][0]));
 
-    GL_CALL(glVertexAttribPointer(posID, 3, GL_FLOAT, GL_FALSE, 0, vertices.data()));
-    GL_CALL(glVertexAttribPointer(uvID, 2, GL_FLOAT, GL_FALSE, 0, coords.data()));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo_pos));
+    GL_CALL(glVertexAttribPointer(posID, 3, GL_FLOAT, GL_FALSE, 0, 0));
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo_uv));
+    GL_CALL(glVertexAttribPointer(uvID, 2, GL_FLOAT, GL_FALSE, 0, 0));
 
     GetTuple(vx, vy, output->workspace->get_current_workspace());
     (void)vy;
@@ -182,10 +229,13 @@ void wf_cube_background_skydome::render_frame(const wf_framebuffer& fb,
     GL_CALL(glActiveTexture(GL_TEXTURE0));
     GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
 
-    GL_CALL(glDrawElements(GL_TRIANGLES,
-            6 * SKYDOME_GRID_WIDTH * (SKYDOME_GRID_HEIGHT - 2),
-            GL_UNSIGNED_INT, indices.data()));
+    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo));
+    GL_CALL(glDrawElements(GL_TRIANGLES, mesh->index_count,
+            GL_UNSIGNED_SHORT, 0));
 
+    /* Other renderers use client-side arrays */
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
     GL_CALL(glDisableVertexAttribArray(posID));
     GL_CALL(glDisableVertexAttribArray(uvID));
     OpenGL::render_end();
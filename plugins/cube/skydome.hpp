@@ -2,8 +2,8 @@
 #define WF_CUBE_BACKGROUND_SKYDOME
 
 #include "cube-background.hpp"
-#include <vector>
 
+struct wf_cube_skydome_mesh;
 class wf_cube_background_skydome : public wf_cube_background_base
 {
     public:
@@ -17,19 +17,19 @@ class wf_cube_background_skydome : public wf_cube_background_base
     wayfire_output *output;
 
     void load_program();
-    void fill_vertices();
+    void reload_mesh();
     void reload_texture();
 
-    GLuint program = -1, tex = -1;
+    GLuint program = -1;
     GLuint posID, uvID, modelID, vpID;
 
-    std::vector<GLfloat> vertices;
-    std::vector<GLfloat> coords;
-    std::vector<GLuint> indices;
-
     std::string last_background_image;
     int last_mirror = -1;
 
+    /* The texture which is shown, and the new one while it is decoded */
+    std::shared_ptr<wf_cube_background_texture> texture, next_texture;
+    std::shared_ptr<wf_cube_skydome_mesh> mesh;
+
     wf_option background_image, mirror_opt;
 };
 
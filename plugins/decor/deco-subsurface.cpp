@@ -14,6 +14,9 @@
 #include "deco-subsurface.hpp"
 
 #include <cairo.h>
+#include <cstring>
+#include <map>
+#include <tuple>
 
 extern "C"
 {
@@ -28,46 +31,159 @@ const int titlebar_thickness = 30;
 const int resize_edge_threshold = 5;
 const int normal_thickness = resize_edge_threshold;
 
-GLuint get_text_texture(int width, int height, std::string text, std::string cairo_font)
-{
-    const auto format = CAIRO_FORMAT_ARGB32;
-    auto surface = cairo_image_surface_create(format, width, height);
-    auto cr = cairo_create(surface);
-
-    const float font_scale = 0.8;
-    const float font_size = height * font_scale;
+/* Titles which change more often are updated at most once per interval */
+const uint32_t title_update_interval = 250;
+/* Limit for the width of title textures, in pixels */
+const int max_title_width = 4096;
 
-    // render text
-    cairo_select_font_face(cr, cairo_font.c_str(), CAIRO_FONT_SLANT_NORMAL,
-        CAIRO_FONT_WEIGHT_NORMAL);
-    cairo_set_source_rgba(cr, 1, 1, 1, 1);
-
-    cairo_set_font_size(cr, font_size);
+/* The rendered text of a titlebar. Titles are rasterized with cairo on the
+ * worker threads, and titlebars with the same title, font and size share
+ * the texture, on all outputs. */
+struct title_texture_t
+{
+    std::string text, font;
+    /* Size of the texture in pixels */
+    int width = 1, height;
+
+    /* Filled in by the worker, uploaded and freed at the first render */
+    std::vector<uint8_t> pixels;
+    bool ready = false;
+    GLuint tex = -1;
+
+    using callback_t = std::function<void()>;
+    std::vector<callback_t*> ready_callbacks;
+
+    ~title_texture_t()
+    {
+        if (tex == (GLuint)-1)
+            return;
+
+        OpenGL::render_begin();
+        GL_CALL(glDeleteTextures(1, &tex));
+        OpenGL::render_end();
+    }
+
+    /* Runs on a worker thread */
+    void rasterize()
+    {
+        const auto format = CAIRO_FORMAT_ARGB32;
+        const float font_scale = 0.8;
+        const float font_size = height * font_scale;
+
+        auto set_font = [&] (cairo_t *cr)
+        {
+            cairo_select_font_face(cr, font.c_str(), CAIRO_FONT_SLANT_NORMAL,
+                CAIRO_FONT_WEIGHT_NORMAL);
+            cairo_set_font_size(cr, font_size);
+        };
 
-    cairo_text_extents_t ext;
-    cairo_text_extents(cr, text.c_str(), &ext);
+        /* Measure the text, so that the texture is just as wide as the title
+         * and doesn't depend on the width of the view */
+        auto surface = cairo_image_surface_create(format, 1, 1);
+        auto cr = cairo_create(surface);
+        set_font(cr);
+
+        cairo_text_extents_t ext;
+        cairo_text_extents(cr, text.c_str(), &ext);
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
+
+        width = clamp((int)std::ceil(normal_thickness + ext.x_advance), 1,
+            max_title_width);
+
+        surface = cairo_image_surface_create(format, width, height);
+        cr = cairo_create(surface);
+        set_font(cr);
+        cairo_set_source_rgba(cr, 1, 1, 1, 1);
+        cairo_move_to(cr, normal_thickness, font_size);
+        cairo_show_text(cr, text.c_str());
+        cairo_destroy(cr);
+
+        cairo_surface_flush(surface);
+        auto src = cairo_image_surface_get_data(surface);
+        int stride = cairo_image_surface_get_stride(surface);
+
+        pixels.resize(4 * width * height);
+        for (int i = 0; i < height; i++)
+            std::memcpy(&pixels[4 * width * i], src + stride * i, 4 * width);
+
+        cairo_surface_destroy(surface);
+    }
+
+    /* Must be called with a GL context, after ready is set */
+    void upload()
+    {
+        if (tex != (GLuint)-1)
+            return;
+
+        GL_CALL(glGenTextures(1, &tex));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0,
+                GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+
+        pixels.clear();
+        pixels.shrink_to_fit();
+    }
+};
 
-    cairo_move_to(cr, normal_thickness, font_size);
-    cairo_show_text(cr, text.c_str());
+class title_texture_cache_t
+{
+    using key_t = std::tuple<std::string, std::string, int>;
+    std::map<key_t, std::weak_ptr<title_texture_t>> entries;
 
-    cairo_destroy(cr);
+    public:
+    /* The rasterization tasks, waited for before the plugin is unloaded */
+    wf::thread_pool_t::async_group_t tasks;
+
+    /* Returns the title with the given parameters. If it isn't rendered
+     * already, rasterization is started on a worker thread */
+    std::shared_ptr<title_texture_t> get(std::string text, std::string font,
+        int height)
+    {
+        key_t key{text, font, height};
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            if (auto title = it->second.lock())
+                return title;
+        }
 
-    auto src = cairo_image_surface_get_data(surface);
+        /* Titles are replaced often, so drop the unused entries */
+        for (auto it = entries.begin(); it != entries.end();)
+        {
+            if (it->second.expired())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
 
-    GLuint tex;
-    GL_CALL(glGenTextures(1, &tex));
-    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+        auto title = std::make_shared<title_texture_t>();
+        title->text = text;
+        title->font = font;
+        title->height = height;
+        entries[key] = title;
 
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, src));
+        /* The done callback keeps the title alive while the worker uses it */
+        auto raw = title.get();
+        core->thread_pool->run_async([raw] () { raw->rasterize(); }, [title] ()
+        {
+            title->ready = true;
+            auto callbacks = title->ready_callbacks;
+            title->ready_callbacks.clear();
+            for (auto callback : callbacks)
+                (*callback) ();
+        }, &tasks);
+
+        return title;
+    }
+};
 
-    cairo_surface_destroy(surface);
-
-    return tex;
-}
+static title_texture_cache_t title_cache;
 
 class simple_decoration_surface : public wayfire_compositor_subsurface_t, public wf_decorator_frame_t
 {
@@ -78,6 +194,14 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
     wf_option font_option;
     signal_callback_t title_set;
 
+    /* The title which is shown, and the new one while it is rendered */
+    std::shared_ptr<title_texture_t> title, next_title;
+    title_texture_t::callback_t title_ready;
+
+    wf::wl_timer title_timer;
+    bool title_timer_pending = false;
+    uint32_t last_title_update = 0;
+
     protected:
         virtual void damage(const wlr_box& box)
         {
@@ -99,10 +223,74 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
             title_set = [=] (signal_data *data)
             {
                 if (get_signaled_view(data) == view)
-                    notify_view_resized(view->get_wm_geometry());
+                    schedule_title_update();
+            };
+
+            title_ready = [=] ()
+            {
+                title = std::move(next_title);
+                next_title = nullptr;
+                this->view->damage();
             };
         }
 
+        /* Request the current title, the old one is shown until it is ready */
+        void update_title()
+        {
+            last_title_update = get_current_time();
+            if (!output || titlebar <= 0)
+                return;
+
+            auto target = title_cache.get(view->get_title(),
+                font_option->as_string(), int(titlebar * output->handle->scale));
+
+            if (target == next_title)
+                return;
+
+            cancel_next_title();
+            if (target == title)
+                return;
+
+            if (target->ready)
+            {
+                title = target;
+                view->damage();
+            } else
+            {
+                next_title = target;
+                next_title->ready_callbacks.push_back(&title_ready);
+            }
+        }
+
+        void cancel_next_title()
+        {
+            if (!next_title)
+                return;
+
+            auto& callbacks = next_title->ready_callbacks;
+            callbacks.erase(std::remove(callbacks.begin(), callbacks.end(),
+                    &title_ready), callbacks.end());
+            next_title = nullptr;
+        }
+
+        /* Rate limit title updates for views which change it all the time */
+        void schedule_title_update()
+        {
+            if (title_timer_pending)
+                return;
+
+            uint32_t elapsed = get_current_time() - last_title_update;
+            if (elapsed >= title_update_interval)
+                return update_title();
+
+            title_timer_pending = true;
+            title_timer.set_timeout(title_update_interval - elapsed, [=] ()
+            {
+                title_timer_pending = false;
+                update_title();
+            });
+        }
+
         virtual void set_output(wayfire_output *next_output)
         {
             if (this->output)
@@ -111,11 +299,16 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
             wayfire_compositor_subsurface_t::set_output(next_output);
 
             if (this->output)
+            {
                 this->output->connect_signal("view-title-changed", &title_set);
+                /* The scale of the new output might be different */
+                update_title();
+            }
         }
 
         virtual ~simple_decoration_surface()
         {
+            cancel_next_title();
         }
 
         virtual bool is_mapped()
@@ -135,8 +328,6 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
         float border_color[4] = {0.15f, 0.15f, 0.15f, 0.8f};
         float border_color_inactive[4] = {0.25f, 0.25f, 0.25f, 0.95f};
 
-        GLuint tex = -1;
-
         virtual void _wlr_render_box(const wf_framebuffer& fb, int x, int y, const wlr_box& scissor)
         {
             wlr_box geometry {x, y, width, height};
@@ -154,22 +345,26 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
 
             wlr_render_quad_with_matrix(core->renderer, active ? border_color : border_color_inactive, matrix);
 
-            if (tex == (uint)-1)
+            if (title && titlebar > 0)
             {
-                tex = get_text_texture(width * fb.scale, titlebar * fb.scale,
-                    view->get_title(), font_option->as_string());
+                title->upload();
+
+                /* The texture is as wide as the text, cut it at the view edge */
+                float title_width = 1.0 * title->width * titlebar / title->height;
+                float visible = std::min(1.0f, width / title_width);
+
+                gl_geometry gg;
+                gg.x1 = x + fb.geometry.x;
+                gg.y1 = y + fb.geometry.y;
+                gg.x2 = gg.x1 + title_width * visible;
+                gg.y2 = gg.y1 + titlebar;
+
+                OpenGL::render_transformed_texture(title->tex, gg,
+                    {0, 0, visible, 1}, fb.get_orthographic_projection(),
+                    {1, 1, 1, 1},
+                    TEXTURE_TRANSFORM_INVERT_Y | TEXTURE_USE_TEX_GEOMETRY);
             }
 
-            gl_geometry gg;
-            gg.x1 = x + fb.geometry.x;
-            gg.y1 = y + fb.geometry.y;
-            gg.x2 = gg.x1 + width;
-            gg.y2 = gg.y1 + titlebar;
-
-            OpenGL::render_transformed_texture(tex, gg, {},
-                fb.get_orthographic_projection(), {1, 1, 1, 1},
-                TEXTURE_TRANSFORM_INVERT_Y);
-
             GL_CALL(glUseProgram(0));
             OpenGL::render_end();
         }
@@ -321,13 +516,6 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
 
         virtual void notify_view_resized(wf_geometry view_geometry)
         {
-            if (tex != (uint32_t)-1)
-            {
-                GL_CALL(glDeleteTextures(1, &tex));
-            }
-
-            tex = -1;
-
             width = view_geometry.width;
             height = view_geometry.height;
 
@@ -351,10 +539,16 @@ class simple_decoration_surface : public wayfire_compositor_subsurface_t, public
                 thickness = normal_thickness;
                 titlebar = titlebar_thickness;
                 view->resize(width, height);
+                update_title();
             }
         };
 };
 
+void wait_title_rendering()
+{
+    core->thread_pool->wait_async(&title_cache.tasks);
+}
+
 void init_view(wayfire_view view, wf_option font)
 {
     auto surf = new simple_decoration_surface(view, font);
@@ -4,5 +4,7 @@
 #include <view.hpp>
 
 void init_view(wayfire_view view, wf_option font);
+/* Wait for the titles which are being rendered, needed before unloading */
+void wait_title_rendering();
 
 #endif /* end of include guard: DECO_SUBSURFACE_HPP */
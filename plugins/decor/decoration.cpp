@@ -36,6 +36,7 @@ class wayfire_decoration : public wayfire_plugin_t
             view->set_decoration(nullptr);
         }, WF_ALL_LAYERS);
         output->disconnect_signal("map-view", &view_created);
+        wait_title_rendering();
     }
 };
 
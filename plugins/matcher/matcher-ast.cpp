@@ -59,34 +59,19 @@ namespace wf
 
         }
 
-        namespace matchers
+        /* How the view attribute is compared with the pattern */
+        enum match_mode
         {
-            using func_t = std::function<bool(string, string)>;
-            func_t exact = [] (string text, string pattern)
-            {
-                if (pattern == "any")
-                    return true;
-
-                bool result = false;
-                try {
-                    result = std::regex_match(text, std::regex(pattern));
-                } catch (const std::exception& e) {
-                    log_error ("Invalid regular expression: %s", pattern.c_str());
-                }
-
-                return result;
-            };
-
-            func_t contains = [] (string text, string pattern)
-            {
-                return text.find(pattern) != text.npos;
-            };
+            /* The whole attribute matches a regular expression */
+            MATCH_IS,
+            /* The attribute contains the pattern as a substring */
+            MATCH_CONTAINS,
+        };
 
-            std::map<string, func_t> matchers = {
-                {"is", exact},
-                {"contains", contains},
-            };
-        }
+        std::map<string, match_mode> match_modes = {
+            {"is", MATCH_IS},
+            {"contains", MATCH_CONTAINS},
+        };
 
         /* Which attribute of the view we want to match against */
         enum match_field
@@ -108,9 +93,14 @@ namespace wf
         struct single_expression_t : public expression_t
         {
             match_field field;
-            matchers::func_t matcher;
+            match_mode mode;
             string matcher_arg;
 
+            /* For MATCH_IS, the pattern is compiled once, when parsing */
+            bool match_anything = false;
+            bool regex_valid = false;
+            std::regex regex;
+
             single_expression_t(string expr)
             {
                 /* A single expression consists of 3 parts:
@@ -122,33 +112,67 @@ namespace wf
                 if (!match_fields.count(tokens[0]))
                     throw std::invalid_argument("Invalid match field: " + tokens[0]);
 
-                if (!matchers::matchers.count(tokens[1]))
+                if (!match_modes.count(tokens[1]))
                     throw std::invalid_argument("Invalid match mode: " + tokens[1]);
 
                 this->field = match_fields[tokens[0]];
-                this->matcher = matchers::matchers[tokens[1]];
+                this->mode = match_modes[tokens[1]];
                 this->matcher_arg = tokens[2];
+
+                if (this->mode == MATCH_IS)
+                    compile_regex();
             }
 
-            bool evaluate(const view_t& view) override
+            void compile_regex()
+            {
+                if (matcher_arg == "any")
+                {
+                    match_anything = true;
+                    return;
+                }
+
+                /* An invalid regular expression doesn't fail the whole
+                 * expression, it just never matches */
+                try {
+                    regex = std::regex(matcher_arg,
+                        std::regex::ECMAScript | std::regex::optimize);
+                    regex_valid = true;
+                } catch (const std::exception& e) {
+                    log_error ("Invalid regular expression: %s", matcher_arg.c_str());
+                }
+            }
+
+            const string& get_field(const view_t& view) const
             {
-                string view_field_data;
                 switch (this->field)
                 {
                     case FIELD_TITLE:
-                        view_field_data = view.title;
-                        break;
+                        return view.title;
                     case FIELD_APP_ID:
-                        view_field_data = view.app_id;
-                        break;
+                        return view.app_id;
                     case FIELD_TYPE:
-                        view_field_data = view.type;
-                        break;
+                        return view.type;
                     case FIELD_FOCUSEABLE:
-                        view_field_data = view.focuseable;
+                    default:
+                        return view.focuseable;
+                }
+            }
+
+            bool evaluate(const view_t& view) override
+            {
+                const string& text = get_field(view);
+                switch (this->mode)
+                {
+                    case MATCH_IS:
+                        if (match_anything)
+                            return true;
+                        return regex_valid && std::regex_match(text, regex);
+
+                    case MATCH_CONTAINS:
+                        return text.find(matcher_arg) != text.npos;
                 }
 
-                return this->matcher(view_field_data, this->matcher_arg);
+                return false;
             }
         };
 
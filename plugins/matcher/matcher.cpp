@@ -6,6 +6,7 @@
 #include <core.hpp>
 #include <output.hpp>
 #include <workspace-manager.hpp>
+#include <unordered_map>
 
 namespace wf
 {
@@ -32,11 +33,61 @@ namespace wf
             return "unknown";
         };
 
+        /* The cached results of all matchers for a single view. They are
+         * dropped whenever the title or the app-id of the view changes. */
+        class view_match_cache_t : public wf_custom_data_t
+        {
+            wayfire_view view;
+            signal_callback_t on_view_changed = [=] (signal_data*)
+            {
+                results.clear();
+            };
+
+            public:
+            struct entry_t
+            {
+                bool result;
+                /* The attributes which can change without a signal */
+                std::string type;
+                bool focuseable;
+            };
+
+            /* Indexed by the serial of the matcher */
+            std::unordered_map<uint64_t, entry_t> results;
+
+            view_match_cache_t(wayfire_view view) : view(view)
+            {
+                view->connect_signal("title-changed", &on_view_changed);
+                view->connect_signal("app-id-changed", &on_view_changed);
+            }
+
+            ~view_match_cache_t()
+            {
+                view->disconnect_signal("title-changed", &on_view_changed);
+                view->disconnect_signal("app-id-changed", &on_view_changed);
+            }
+
+            static nonstd::observer_ptr<view_match_cache_t> get(wayfire_view view)
+            {
+                if (!view->has_data<view_match_cache_t>())
+                {
+                    view->store_data(
+                        std::make_unique<view_match_cache_t> (view));
+                }
+
+                return view->get_data<view_match_cache_t>();
+            }
+        };
+
         class default_view_matcher : public view_matcher
         {
             std::unique_ptr<expression_t> expr;
             wf_option match_option;
 
+            /* Identifies the current expression in the view caches. A new
+             * serial is used each time the expression changes. */
+            uint64_t serial;
+
             wf_option_callback on_match_string_updated = [=] ()
             {
                 auto result = parse_expression(match_option->as_string());
@@ -47,6 +98,9 @@ namespace wf
                 }
 
                 this->expr = std::move(result.first);
+
+                static uint64_t next_serial = 0;
+                this->serial = next_serial++;
             };
 
             public:
@@ -62,18 +116,32 @@ namespace wf
                 match_option->rem_updated_handler(&on_match_string_updated);
             }
 
-            virtual bool matches(wayfire_view view) const
+            bool matches(wayfire_view view) override
             {
                 if (!expr || !view->is_mapped())
                     return false;
 
+                auto type = get_view_type(view);
+                bool focuseable = view->is_focuseable();
+
+                auto cache = view_match_cache_t::get(view);
+                auto it = cache->results.find(serial);
+                if (it != cache->results.end() && it->second.type == type &&
+                    it->second.focuseable == focuseable)
+                {
+                    return it->second.result;
+                }
+
                 view_t data;
                 data.title = view->get_title();
                 data.app_id = view->get_app_id();
-                data.type = get_view_type(view);
-                data.focuseable = view->is_focuseable() ?  "true" : "false";
+                data.type = type;
+                data.focuseable = focuseable ?  "true" : "false";
+
+                bool result = expr->evaluate(data);
+                cache->results[serial] = {result, type, focuseable};
 
-                return expr->evaluate(data);
+                return result;
             }
         };
 
@@ -87,12 +155,11 @@ namespace wf
 
             signal_callback_t on_matcher_evaluate = [=] (signal_data *data)
             {
+                /* wf::matcher::evaluate() calls the matcher directly, this
+                 * is kept for callers which still use the signal */
                 auto ev = static_cast<match_evaluate_signal*> (data);
-                auto expr =
-                    dynamic_cast<default_view_matcher*> (ev->matcher.get());
-
-                if (expr)
-                    ev->result = expr->matches(ev->view);
+                if (ev->matcher)
+                    ev->result = ev->matcher->matches(ev->view);
             };
 
             public:
@@ -3,6 +3,8 @@
 
 #include <core.hpp>
 #include <view.hpp>
+#include <output.hpp>
+#include <workspace-manager.hpp>
 #include <config.hpp>
 
 namespace wf
@@ -13,6 +15,10 @@ namespace wf
         {
             public:
             virtual ~view_matcher() = default;
+
+            /* Returns whether the view matches. Implemented by the matcher
+             * plugin, so that evaluating doesn't need to go through core */
+            virtual bool matches(wayfire_view view) = 0;
         };
 
         struct match_signal : public signal_data
@@ -25,7 +31,7 @@ namespace wf
 
         /* Tries to create a view matcher on the given domain (usually the output
          * of the plugin) with the given expression. May return null */
-        std::unique_ptr<view_matcher> get_matcher(wf_option expression)
+        inline std::unique_ptr<view_matcher> get_matcher(wf_option expression)
         {
             match_signal data;
             data.expression = expression;
@@ -41,16 +47,32 @@ namespace wf
         };
 
 #define WF_MATCHER_EVALUATE_SIGNAL "matcher-evaluate-match"
-        bool evaluate(const std::unique_ptr<view_matcher>& matcher,
+        inline bool evaluate(const std::unique_ptr<view_matcher>& matcher,
             wayfire_view view)
         {
-            match_evaluate_signal data;
-            data.matcher = nonstd::make_observer(matcher.get());
-            data.view = view;
-            data.result = false; // by default
+            if (!matcher)
+                return false;
+
+            return matcher->matches(view);
+        }
+
+        /* Returns all views in the given layers of the output which match,
+         * from the topmost to the bottommost one */
+        inline std::vector<wayfire_view> evaluate_all(
+            const std::unique_ptr<view_matcher>& matcher,
+            wayfire_output *output, uint32_t layers_mask = WF_ALL_LAYERS)
+        {
+            std::vector<wayfire_view> result;
+            if (!matcher)
+                return result;
+
+            output->workspace->for_each_view([&] (wayfire_view view)
+            {
+                if (matcher->matches(view))
+                    result.push_back(view);
+            }, layers_mask);
 
-            core->emit_signal(WF_MATCHER_EVALUATE_SIGNAL, &data);
-            return data.result;
+            return result;
         }
     }
 }
@@ -0,0 +1,409 @@
+#include <output.hpp>
+#include <core.hpp>
+#include <debug.hpp>
+#include <render-manager.hpp>
+#include <workspace-manager.hpp>
+#include <compositor-view.hpp>
+#include <signal-definitions.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include "../wobbly/wobbly-signal.hpp"
+
+/* A render benchmark with a scripted scene.
+ *
+ * When started, bench spawns a number of synthetic views on the output and
+ * for a fixed number of frames moves, resizes and damages them, and switches
+ * workspaces in between. At the end it reports frames per second, the median
+ * and 99th percentile of render_manager::paint() and the damaged area per
+ * frame, as recorded in the render_manager's frame timings.
+ *
+ * For repeatable runs, start wayfire on the headless backend with software GL
+ * and a config which enables the plugins to compare, for example:
+ *
+ *   WLR_BACKENDS=headless LIBGL_ALWAYS_SOFTWARE=1 wayfire -c bench.ini
+ *
+ * with autostart and quit_on_finish set in the [bench] section.
+ *
+ * bench also reports how long mapping each of its views takes, which is
+ * mostly spent in the "map-view" handlers of the other plugins. To measure
+ * the cost of many window rules, set window_rules to the number of rules
+ * to generate and list bench before window-rules in the plugins option, so
+ * that the rules exist when window-rules reads them. */
+
+/* A colored rectangle view which can also be damaged partially, like a client
+ * with a blinking cursor */
+class bench_view_t : public wayfire_color_rect_view_t
+{
+    public:
+        std::string title, app_id;
+
+        virtual std::string get_title() { return title; }
+        virtual std::string get_app_id() { return app_id; }
+
+        void damage_box(const wlr_box& box)
+        {
+            damage(box + wf_point{geometry.x, geometry.y});
+        }
+};
+
+/* Add count rules to the [window-rules] section. A few of them apply to the
+ * bench views when they are mapped, the others are checked but don't match,
+ * and a quarter of them are for another event. */
+static void generate_window_rules(wayfire_config *config, int count)
+{
+    auto section = config->get_section("window-rules");
+    for (int i = 0; i < count; i++)
+    {
+        auto id = std::to_string(i);
+        std::string rule;
+        switch (i % 4)
+        {
+            case 0:
+                rule = "app-id bench-" + id + " created -> move 0 0";
+                break;
+            case 1:
+                rule = "title contains view " + id + " created -> resize 400 300";
+                break;
+            case 2:
+                rule = "app-id contains app-" + id + " maximized -> unset maximized";
+                break;
+            default:
+                rule = "title other window " + id + " created -> set fullscreen";
+                break;
+        }
+
+        /* Doesn't change rules which already exist, when there are several
+         * outputs */
+        section->get_option("bench_rule_" + id, rule);
+    }
+}
+
+static int running_benchmarks = 0;
+
+class wayfire_bench : public wayfire_plugin_t
+{
+    wf_option num_views, num_frames, resize_interval, switch_interval;
+    wf_option use_wobbly, report_file, quit_on_finish, num_rules;
+
+    activator_callback toggle_cb = [=] (wf_activator_source, uint32_t)
+    {
+        if (running)
+            finish();
+        else
+            start();
+    };
+
+    struct bench_view_state
+    {
+        bench_view_t *view;
+        /* The workspace the view is on */
+        int ws_x, ws_y;
+        float phase;
+    };
+
+    std::vector<bench_view_state> views;
+    std::vector<wf_frame_timing> timings;
+    /* In nanoseconds */
+    std::vector<int64_t> map_times;
+
+    bool running = false;
+    int frame = 0;
+    uint32_t start_time;
+
+    wf::wl_idle_call idle_start, idle_finish;
+
+    effect_hook_t step_scene = [=] () { step(); };
+
+    signal_callback_t on_frame_timing = [=] (signal_data *data)
+    {
+        auto ev = static_cast<wf_frame_timing_signal*> (data);
+        timings.push_back(*ev->timing);
+
+        if ((int)timings.size() >= num_frames->as_cached_int())
+            idle_finish.run_once([=] () { finish(); });
+    };
+
+    public:
+    void init(wayfire_config *config)
+    {
+        grab_interface->name = "bench";
+        grab_interface->abilities_mask = WF_ABILITY_CHANGE_VIEW_GEOMETRY;
+
+        auto section = config->get_section("bench");
+        num_views       = section->get_option("views", "16");
+        num_frames      = section->get_option("frames", "600");
+        resize_interval = section->get_option("resize_interval", "30");
+        switch_interval = section->get_option("workspace_switch_interval", "120");
+        use_wobbly      = section->get_option("wobbly", "0");
+        report_file     = section->get_option("report_file", "");
+        quit_on_finish  = section->get_option("quit_on_finish", "0");
+        num_rules       = section->get_option("window_rules", "0");
+
+        if (num_rules->as_int() > 0)
+            generate_window_rules(config, num_rules->as_int());
+
+        auto toggle = section->get_option("toggle", "<super> <shift> KEY_B");
+        output->add_activator(toggle, &toggle_cb);
+
+        grab_interface->callbacks.cancel = [=] () { finish(); };
+
+        if (section->get_option("autostart", "0")->as_int())
+            idle_start.run_once([=] () { start(); });
+    }
+
+    void start()
+    {
+        if (running || !output->activate_plugin(grab_interface))
+            return;
+
+        running = true;
+        ++running_benchmarks;
+
+        frame = 0;
+        timings.clear();
+        map_times.clear();
+        spawn_views();
+
+        output->render->add_effect(&step_scene, WF_OUTPUT_EFFECT_PRE);
+        output->render->connect_signal("frame-timing", &on_frame_timing);
+        output->render->auto_redraw(true);
+        output->render->damage_whole();
+
+        start_time = get_current_time();
+        log_info("bench: starting on %s with %d views for %d frames",
+            output->handle->name, num_views->as_int(), num_frames->as_int());
+    }
+
+    void spawn_views()
+    {
+        GetTuple(vw, vh, output->workspace->get_workspace_grid_size());
+        GetTuple(cx, cy, output->workspace->get_current_workspace());
+
+        int count = num_views->as_cached_int();
+        for (int i = 0; i < count; i++)
+        {
+            auto view = new bench_view_t();
+            view->set_output(output);
+
+            float hue = 1.0f * i / std::max(count, 1);
+            view->set_color({hue, 1.0f - hue, 0.5f, i % 2 ? 1.0f : 0.8f});
+            view->set_border(4);
+            view->title = "bench view " + std::to_string(i);
+            view->app_id = "bench-" + std::to_string(i);
+
+            core->add_view(std::unique_ptr<wayfire_view_t> (view));
+
+            auto map_start = std::chrono::steady_clock::now();
+            view->map();
+            auto map_time = std::chrono::steady_clock::now() - map_start;
+            map_times.push_back(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(map_time).count());
+
+            /* Half of the views stay on the current workspace, the rest are
+             * spread over the whole workspace grid */
+            bench_view_state state;
+            state.view = view;
+            state.ws_x = (i % 2) ? cx : (i / 2) % vw;
+            state.ws_y = (i % 2) ? cy : (i / 2 / vw) % vh;
+            state.phase = i * 0.7f;
+
+            view->set_geometry(get_view_geometry(state, 0));
+            if (use_wobbly->as_cached_int())
+            {
+                auto g = view->get_wm_geometry();
+                start_wobbly(view->self(), g.x + g.width / 2, g.y + g.height / 2);
+            }
+
+            views.push_back(state);
+        }
+    }
+
+    /* Returns the geometry of the view at the given frame, relative to the
+     * current workspace */
+    wf_geometry get_view_geometry(const bench_view_state& state, int frame)
+    {
+        auto og = output->get_relative_geometry();
+        GetTuple(cx, cy, output->workspace->get_current_workspace());
+
+        int width = og.width / 4, height = og.height / 4;
+        int interval = resize_interval->as_cached_int();
+        if (interval > 0 && (frame / interval) % 2)
+        {
+            width = width * 3 / 2;
+            height = height * 3 / 2;
+        }
+
+        float t = frame * 0.02f + state.phase;
+        int x = og.width / 2  + (og.width  / 3) * std::sin(t) - width / 2;
+        int y = og.height / 2 + (og.height / 3) * std::cos(t * 1.3f) - height / 2;
+
+        return {
+            x + (state.ws_x - cx) * og.width,
+            y + (state.ws_y - cy) * og.height,
+            width, height
+        };
+    }
+
+    void step()
+    {
+        ++frame;
+        for (auto& state : views)
+        {
+            auto g = get_view_geometry(state, frame);
+            state.view->set_geometry(g);
+
+            if (use_wobbly->as_cached_int())
+            {
+                move_wobbly(state.view->self(),
+                    g.x + g.width / 2, g.y + g.height / 2);
+            }
+
+            /* Simulate a blinking cursor */
+            if (frame % 2)
+                state.view->damage_box({g.width / 2, g.height / 2, 8, 16});
+        }
+
+        int interval = switch_interval->as_cached_int();
+        if (interval > 0 && frame % interval == 0)
+        {
+            GetTuple(vw, vh, output->workspace->get_workspace_grid_size());
+            GetTuple(cx, cy, output->workspace->get_current_workspace());
+
+            int next = (cx + cy * vw + 1) % (vw * vh);
+            output->workspace->set_workspace(
+                std::make_tuple(next % vw, next / vw));
+        }
+    }
+
+    void destroy_views()
+    {
+        for (auto& state : views)
+        {
+            if (use_wobbly->as_cached_int())
+                end_wobbly(state.view->self());
+
+            state.view->close();
+        }
+
+        views.clear();
+    }
+
+    void report()
+    {
+        if (timings.empty())
+            return;
+
+        uint32_t elapsed = std::max(get_current_time() - start_time, 1u);
+        double fps = 1000.0 * timings.size() / elapsed;
+
+        std::vector<int64_t> paint_times;
+        int64_t total_area = 0, total_surfaces = 0, total_delay = 0;
+        int64_t phase_sum[WF_FRAME_PHASE_TOTAL] = {0};
+        for (auto& timing : timings)
+        {
+            paint_times.push_back(timing.total());
+            total_area += timing.damaged_area;
+            total_surfaces += timing.surface_count;
+            total_delay += timing.render_delay;
+
+            for (int i = 0; i < WF_FRAME_PHASE_TOTAL; i++)
+                phase_sum[i] += timing.phase_time[i];
+        }
+
+        std::sort(paint_times.begin(), paint_times.end());
+        size_t n = paint_times.size();
+        int64_t p50 = paint_times[n / 2];
+        int64_t p99 = paint_times[std::min(n - 1, n * 99 / 100)];
+
+        int64_t map_p50 = 0, map_p99 = 0;
+        if (!map_times.empty())
+        {
+            std::sort(map_times.begin(), map_times.end());
+            size_t m = map_times.size();
+            map_p50 = map_times[m / 2];
+            map_p99 = map_times[std::min(m - 1, m * 99 / 100)];
+        }
+
+        auto plugins = core->config->get_section("core")
+            ->get_option("plugins", "")->as_string();
+
+        char summary[1024];
+        snprintf(summary, sizeof(summary),
+            "output=%s views=%d frames=%zu fps=%.2f paint_p50_us=%" PRId64
+            " paint_p99_us=%" PRId64 " damage_per_frame=%" PRId64
+            " surfaces_per_frame=%" PRId64 " render_delay_avg_us=%" PRId64
+            " window_rules=%d map_p50_ns=%" PRId64 " map_p99_ns=%" PRId64,
+            output->handle->name, num_views->as_cached_int(), n, fps, p50, p99,
+            total_area / (int64_t)n, total_surfaces / (int64_t)n,
+            total_delay / (int64_t)n, num_rules->as_cached_int(),
+            map_p50, map_p99);
+
+        auto pool = OpenGL::get_framebuffer_pool_stats();
+        uint64_t pool_requests = std::max(pool.hits + pool.misses, (uint64_t)1);
+
+        log_info("bench: %s", summary);
+        log_info("bench: framebuffer pool: hit rate %.2f, %" PRIu64
+            " evictions, %zu buffers (%zu KiB) pooled",
+            1.0 * pool.hits / pool_requests, pool.evictions,
+            pool.pooled_buffers, pool.pooled_bytes >> 10);
+        log_info("bench: plugins: %s", plugins.c_str());
+
+        auto path = report_file->as_string();
+        if (path.empty())
+            return;
+
+        FILE *file = fopen(path.c_str(), "a");
+        if (!file)
+        {
+            log_error("bench: failed to open report file %s", path.c_str());
+            return;
+        }
+
+        fprintf(file, "%s", summary);
+        for (int i = 0; i < WF_FRAME_PHASE_TOTAL; i++)
+            fprintf(file, " phase%d_avg_us=%" PRId64, i, phase_sum[i] / (int64_t)n);
+        fprintf(file, " fb_pool_hit_rate=%.2f fb_pool_evictions=%" PRIu64,
+            1.0 * pool.hits / pool_requests, pool.evictions);
+        fprintf(file, " plugins=\"%s\"\n", plugins.c_str());
+        fclose(file);
+    }
+
+    void finish()
+    {
+        if (!running)
+            return;
+
+        running = false;
+        idle_finish.disconnect();
+
+        output->render->rem_effect(&step_scene);
+        output->render->disconnect_signal("frame-timing", &on_frame_timing);
+        output->render->auto_redraw(false);
+
+        destroy_views();
+        report();
+        output->deactivate_plugin(grab_interface);
+
+        if (--running_benchmarks == 0 && quit_on_finish->as_int())
+            wl_display_terminate(core->display);
+    }
+
+    void fini()
+    {
+        idle_start.disconnect();
+        finish();
+        output->rem_binding(&toggle_cb);
+    }
+};
+
+extern "C"
+{
+    wayfire_plugin_t* newInstance()
+    {
+        return new wayfire_bench;
+    }
+}
@@ -136,7 +136,6 @@ class wayfire_expo : public wayfire_plugin_t
         calculate_zoom(true);
 
         output->render->set_renderer(renderer);
-        output->render->auto_redraw(true);
     }
 
     void deactivate()
@@ -337,7 +336,8 @@ class wayfire_expo : public wayfire_plugin_t
             {
                 if (!streams[i][j]->running)
                 {
-                    output->render->workspace_stream_start(streams[i][j].get());
+                    output->render->workspace_stream_start(streams[i][j].get(),
+                        render_params.scale_x, render_params.scale_y);
                 } else
                 {
                     output->render->workspace_stream_update(streams[i][j].get(),
@@ -366,7 +366,8 @@ class wayfire_expo : public wayfire_plugin_t
 
         OpenGL::render_begin(fb);
         OpenGL::clear(background_color->as_cached_color());
-        fb.scissor(fb.framebuffer_box_from_geometry_box(fb.geometry));
+        auto scissor_box = fb.framebuffer_box_from_geometry_box(fb.geometry);
+        wf_texture_batch batch(fb);
 
         /* Space between adjacent workspaces */
         float hspacing = 1.0 * render_params.delimiter_offset / w;
@@ -396,11 +397,12 @@ class wayfire_expo : public wayfire_plugin_t
                 /* Undo rotation of the workspace */
                 workspace_transform = workspace_transform * glm::inverse(fb.transform);
 
-                OpenGL::render_transformed_texture(streams[i][j]->buffer.tex,
-                    out_geometry, {}, workspace_transform);
+                batch.add_quad(streams[i][j]->buffer.tex, out_geometry, {},
+                    workspace_transform, glm::vec4(1.0f), 0, scissor_box);
             }
         }
 
+        batch.flush();
         GL_CALL(glUseProgram(0));
         OpenGL::render_end();
 
@@ -453,6 +455,8 @@ class wayfire_expo : public wayfire_plugin_t
 
         state.zoom_in = zoom_in;
         zoom_animation.start();
+        output->render->schedule_frames_until(
+            get_current_time() + zoom_animation_duration->as_cached_int());
     }
 
     void update_zoom()
@@ -484,7 +488,6 @@ class wayfire_expo : public wayfire_plugin_t
         }
 
         output->render->reset_renderer();
-        output->render->auto_redraw(false);
     }
 
     void fini()
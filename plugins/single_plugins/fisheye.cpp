@@ -112,7 +112,7 @@ class wayfire_fisheye : public wayfire_plugin_t
     void load_program()
     {
         OpenGL::render_begin();
-        program = OpenGL::create_program_from_source(
+        program = OpenGL::create_shared_program_from_source(
             vertex_shader, fragment_shader);
 
         posID = GL_CALL(glGetAttribLocation(program, "position"));
@@ -229,7 +229,7 @@ class wayfire_fisheye : public wayfire_plugin_t
                 finalize();
 
             OpenGL::render_begin();
-            GL_CALL(glDeleteProgram(program));
+            OpenGL::destroy_program(program);
             OpenGL::render_end();
 
             output->rem_binding(&toggle_cb);
@@ -26,7 +26,7 @@ class wayfire_grid_view_cdata : public wf_custom_data_t
     uint32_t tiled_edges;
     wf_geometry target, initial;
     wayfire_grab_interface iface;
-    wf_option animation_type;
+    wf_option animation_type, animation_duration;
 
     public:
 
@@ -37,6 +37,7 @@ class wayfire_grid_view_cdata : public wf_custom_data_t
         this->output = view->get_output();
         this->iface = iface;
         this->animation_type = animation_type;
+        this->animation_duration = animation_duration;
         duration = wf_duration(animation_duration);
 
         if (!view->get_output()->activate_plugin(iface))
@@ -56,7 +57,6 @@ class wayfire_grid_view_cdata : public wf_custom_data_t
                 destroy();
         };
 
-        output->render->auto_redraw(true);
         output->connect_signal("view-disappeared", &unmapped);
         output->connect_signal("detach-view", &unmapped);
     }
@@ -97,6 +97,8 @@ class wayfire_grid_view_cdata : public wf_custom_data_t
         view->set_moving(1);
         view->set_resizing(1);
         duration.start();
+        output->render->schedule_frames_until(
+            get_current_time() + animation_duration->as_cached_int());
     }
 
     void set_end_state(wf_geometry geometry, uint32_t edges)
@@ -139,7 +141,6 @@ class wayfire_grid_view_cdata : public wf_custom_data_t
 
         output->render->rem_effect(&pre_hook);
         output->deactivate_plugin(iface);
-        output->render->auto_redraw(false);
         output->disconnect_signal("view-disappeared", &unmapped);
         output->disconnect_signal("detach-view", &unmapped);
     }
@@ -83,6 +83,8 @@ class wf_move_snap_preview : public wayfire_color_rect_view_t
     const wf_color base_border = {0.25, 0.25, 0.5, 0.8};
     const int base_border_w = 3;
 
+    const wf_option duration_length = new_static_option("200");
+
     public:
     wf_duration duration;
     move_snap_preview_animation animation;
@@ -92,7 +94,7 @@ class wf_move_snap_preview : public wayfire_color_rect_view_t
         animation.start_geometry = animation.end_geometry = start_geometry;
         animation.alpha = {0, 1};
 
-        duration = wf_duration{new_static_option("200")};
+        duration = wf_duration{duration_length};
         pre_paint = [=] () { update_animation(); };
         output->render->add_effect(&pre_paint, WF_OUTPUT_EFFECT_PRE);
 
@@ -128,6 +130,8 @@ class wf_move_snap_preview : public wayfire_color_rect_view_t
 
         animation.end_geometry = target;
         duration.start();
+        output->render->schedule_frames_until(
+            get_current_time() + duration_length->as_cached_int());
     }
 
     void update_animation()
@@ -339,7 +343,6 @@ class wayfire_move : public wayfire_plugin_t
                 slot.slot_id = 0;
 
             this->view = view;
-            output->render->auto_redraw(true);
 
             start_wobbly(view, sx, sy);
             if (!stuck_in_slot)
@@ -356,7 +359,6 @@ class wayfire_move : public wayfire_plugin_t
 
             grab_interface->ungrab();
             output->deactivate_plugin(grab_interface);
-            output->render->auto_redraw(false);
 
             /* The view was moved to another output or was destroyed,
              * we don't have to do anything more */
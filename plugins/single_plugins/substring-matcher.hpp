@@ -0,0 +1,103 @@
+#ifndef SUBSTRING_MATCHER_HPP
+#define SUBSTRING_MATCHER_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+/* An Aho-Corasick automaton, which finds all patterns contained in a text
+ * with a single pass over the text */
+class substring_matcher_t
+{
+    struct node_t
+    {
+        std::map<char, int> next;
+        /* The longest proper suffix of this node which is also in the trie */
+        int fail = 0;
+        /* The closest node on the fail chain which ends a pattern, or -1 */
+        int output_link = -1;
+        /* The patterns which end at this node */
+        std::vector<int> patterns;
+    };
+
+    std::vector<node_t> nodes = std::vector<node_t>(1);
+
+    int step(int state, char c) const
+    {
+        while (true)
+        {
+            auto it = nodes[state].next.find(c);
+            if (it != nodes[state].next.end())
+                return it->second;
+            if (state == 0)
+                return 0;
+
+            state = nodes[state].fail;
+        }
+    }
+
+    public:
+    /* Add a pattern. build() must be called after all patterns are added. */
+    void add(const std::string& pattern, int id)
+    {
+        int state = 0;
+        for (char c : pattern)
+        {
+            auto it = nodes[state].next.find(c);
+            if (it == nodes[state].next.end())
+            {
+                nodes[state].next[c] = nodes.size();
+                state = nodes.size();
+                nodes.emplace_back();
+            } else
+            {
+                state = it->second;
+            }
+        }
+
+        nodes[state].patterns.push_back(id);
+    }
+
+    /* Compute the fail links, in BFS order */
+    void build()
+    {
+        std::vector<int> queue;
+        for (auto& child : nodes[0].next)
+        {
+            nodes[child.second].fail = 0;
+            queue.push_back(child.second);
+        }
+
+        for (size_t i = 0; i < queue.size(); i++)
+        {
+            int state = queue[i];
+            for (auto& child : nodes[state].next)
+            {
+                int fail = step(nodes[state].fail, child.first);
+                auto& node = nodes[child.second];
+                node.fail = fail;
+                node.output_link = nodes[fail].patterns.empty() ?
+                    nodes[fail].output_link : fail;
+
+                queue.push_back(child.second);
+            }
+        }
+    }
+
+    /* Add the IDs of all patterns found in the text to result */
+    void find_all(const std::string& text, std::vector<int>& result) const
+    {
+        int state = 0;
+        for (char c : text)
+        {
+            state = step(state, c);
+            for (int out = state; out > 0; out = nodes[out].output_link)
+            {
+                result.insert(result.end(),
+                    nodes[out].patterns.begin(), nodes[out].patterns.end());
+            }
+        }
+    }
+};
+
+#endif /* end of include guard: SUBSTRING_MATCHER_HPP */
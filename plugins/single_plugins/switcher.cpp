@@ -69,7 +69,7 @@ class WayfireSwitcher : public wayfire_plugin_t
     wf_duration duration;
     wf_duration background_dim_duration;
 
-    wf_option view_thumbnail_scale, touch_sensitivity;
+    wf_option view_thumbnail_scale, touch_sensitivity, speed;
 
     /* If a view comes before another in this list, it is on top of it */
     std::vector<SwitcherView> views;
@@ -79,7 +79,6 @@ class WayfireSwitcher : public wayfire_plugin_t
     key_callback next_view_binding, prev_view_binding;
     gesture_callback touch_activate;
 
-    effect_hook_t damage;
     render_hook_t switcher_renderer;
 
     signal_callback_t view_removed;
@@ -94,17 +93,12 @@ class WayfireSwitcher : public wayfire_plugin_t
 
         switcher_renderer = [=] (const wf_framebuffer& buffer) { render_output(buffer); };
 
-        damage = [=] ()
-        {
-            output->render->damage_whole();
-        };
-
         auto section = config->get_section("switcher");
 
         view_thumbnail_scale = section->get_option("view_thumbnail_scale", "1.0");
         touch_sensitivity = section->get_option("touch_sensitivity", "1.0");
 
-        auto speed = section->get_option("speed", "500");
+        speed = section->get_option("speed", "500");
         duration = wf_duration{speed, wf_animation::circle};
         background_dim_duration = wf_duration{speed, wf_animation::circle};
 
@@ -254,9 +248,7 @@ class WayfireSwitcher : public wayfire_plugin_t
         if (!output->activate_plugin(grab_interface))
             return false;
 
-        output->render->add_effect(&damage, WF_OUTPUT_EFFECT_PRE);
         output->render->set_renderer(switcher_renderer);
-        output->render->auto_redraw(true);
         return true;
     }
 
@@ -265,9 +257,7 @@ class WayfireSwitcher : public wayfire_plugin_t
     {
         output->deactivate_plugin(grab_interface);
 
-        output->render->rem_effect(&damage);
         output->render->reset_renderer();
-        output->render->auto_redraw(false);
 
         output->workspace->for_each_view([=] (wayfire_view view) {
             view->pop_transformer(switcher_transformer);
@@ -277,6 +267,15 @@ class WayfireSwitcher : public wayfire_plugin_t
         views.clear();
     }
 
+    /* Start the animation of the views. The custom renderer repaints at
+     * every frame until it is over, or when something on screen is damaged */
+    void start_animation()
+    {
+        duration.start();
+        output->render->schedule_frames_until(
+            get_current_time() + speed->as_cached_int());
+    }
+
     /* offset from the left or from the right */
     float get_center_offset()
     {
@@ -456,8 +455,8 @@ class WayfireSwitcher : public wayfire_plugin_t
         // clear views in case that deinit() hasn't been run
         views.clear();
 
-        duration.start();
         background_dim_duration.start(1, background_dim_factor);
+        start_animation();
 
         auto ws_views = get_workspace_views();
         for (auto v : ws_views)
@@ -509,7 +508,7 @@ class WayfireSwitcher : public wayfire_plugin_t
         }
 
         background_dim_duration.start(background_dim_duration.progress(), 1);
-        duration.start();
+        start_animation();
         active = false;
 
         /* Potentially restore view[0] if it was maximized */
@@ -718,7 +717,7 @@ class WayfireSwitcher : public wayfire_plugin_t
         rebuild_view_list();
         if (!views.front().view->minimized)
             output->focus_view(views.front().view);
-        duration.start();
+        start_animation();
     }
 
     int count_different_active_views()
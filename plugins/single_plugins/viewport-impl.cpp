@@ -8,6 +8,7 @@
 #include <opengl.hpp>
 #include <list>
 #include <algorithm>
+#include <unordered_map>
 
 struct wf_default_workspace_implementation : public wf_workspace_implementation
 {
@@ -18,6 +19,250 @@ struct wf_default_workspace_implementation : public wf_workspace_implementation
 
 using wf_layer_container = std::list<wayfire_view>;
 
+/* A uniform grid over the output-local bounding boxes of the views, used to
+ * find the views at a point or on a workspace without checking every view.
+ *
+ * Every change of a view's bounding box (moving, resizing, transformers,
+ * subsurfaces) damages the view, so views are marked as dirty when they are
+ * damaged and re-indexed lazily on the next query. */
+class view_spatial_index_t
+{
+    static constexpr int cell_size = 512;
+
+    struct entry_t
+    {
+        wayfire_view view;
+        /* Union of the bounding box and the WM geometry of the view */
+        wf_geometry box;
+        /* The range of cells the view is in, inclusive */
+        int cx1, cy1, cx2, cy2;
+        bool in_cells = false;
+        bool dirty = true;
+
+        /* Stacking order: the layer index and the time the view was last
+         * put on top of its layer */
+        int layer;
+        uint64_t stack_position;
+
+        signal_callback_t on_damage;
+    };
+
+    std::unordered_map<wayfire_view_t*, entry_t> entries;
+    std::unordered_map<uint64_t, std::vector<wayfire_view_t*>> cells;
+    /* Shell views are visible on all workspaces, so they aren't put in cells */
+    std::vector<wayfire_view_t*> shell_views;
+    std::vector<wayfire_view_t*> dirty_views;
+
+    static int cell_coordinate(int x)
+    {
+        /* Round towards negative infinity */
+        return x >= 0 ? x / cell_size : -((-x + cell_size - 1) / cell_size);
+    }
+
+    static uint64_t cell_key(int cx, int cy)
+    {
+        return (uint64_t(uint32_t(cx)) << 32) | uint32_t(cy);
+    }
+
+    void remove_from_cells(entry_t& entry)
+    {
+        auto ptr = entry.view.get();
+        if (!entry.in_cells)
+        {
+            auto it = std::find(shell_views.begin(), shell_views.end(), ptr);
+            if (it != shell_views.end())
+                shell_views.erase(it);
+            return;
+        }
+
+        for (int cx = entry.cx1; cx <= entry.cx2; cx++)
+        {
+            for (int cy = entry.cy1; cy <= entry.cy2; cy++)
+            {
+                auto it = cells.find(cell_key(cx, cy));
+                if (it == cells.end())
+                    continue;
+
+                auto& cell = it->second;
+                auto pos = std::find(cell.begin(), cell.end(), ptr);
+                if (pos != cell.end())
+                {
+                    *pos = cell.back();
+                    cell.pop_back();
+                }
+
+                if (cell.empty())
+                    cells.erase(it);
+            }
+        }
+
+        entry.in_cells = false;
+    }
+
+    void index_entry(entry_t& entry)
+    {
+        auto view = entry.view;
+        auto bbox = view->get_bounding_box();
+        auto wm = view->get_wm_geometry();
+
+        int x1 = std::min(bbox.x, wm.x);
+        int y1 = std::min(bbox.y, wm.y);
+        int x2 = std::max(bbox.x + bbox.width, wm.x + wm.width);
+        int y2 = std::max(bbox.y + bbox.height, wm.y + wm.height);
+        entry.box = {x1, y1, x2 - x1, y2 - y1};
+
+        if (view->role == WF_VIEW_ROLE_SHELL_VIEW)
+        {
+            shell_views.push_back(view.get());
+            return;
+        }
+
+        entry.cx1 = cell_coordinate(x1);
+        entry.cy1 = cell_coordinate(y1);
+        entry.cx2 = cell_coordinate(std::max(x2 - 1, x1));
+        entry.cy2 = cell_coordinate(std::max(y2 - 1, y1));
+        for (int cx = entry.cx1; cx <= entry.cx2; cx++)
+        {
+            for (int cy = entry.cy1; cy <= entry.cy2; cy++)
+                cells[cell_key(cx, cy)].push_back(view.get());
+        }
+
+        entry.in_cells = true;
+    }
+
+    void mark_dirty(entry_t& entry)
+    {
+        if (!entry.dirty)
+        {
+            entry.dirty = true;
+            dirty_views.push_back(entry.view.get());
+        }
+    }
+
+    /* Re-index all views whose geometry might have changed */
+    void flush()
+    {
+        for (auto ptr : dirty_views)
+        {
+            auto& entry = entries.at(ptr);
+            remove_from_cells(entry);
+            index_entry(entry);
+            entry.dirty = false;
+        }
+
+        dirty_views.clear();
+    }
+
+    public:
+    ~view_spatial_index_t()
+    {
+        for (auto& it : entries)
+            it.second.view->disconnect_signal(wf::signals::damaged_region,
+                &it.second.on_damage);
+    }
+
+    /* Add the view if it isn't in the index yet, and update its position in
+     * the stacking order */
+    void update(wayfire_view view, int layer, uint64_t stack_position)
+    {
+        auto it = entries.find(view.get());
+        if (it == entries.end())
+        {
+            auto& entry = entries[view.get()];
+            entry.view = view;
+            entry.on_damage = [this, &entry] (signal_data*) { mark_dirty(entry); };
+            view->connect_signal(wf::signals::damaged_region, &entry.on_damage);
+
+            /* Not in cells yet, will be indexed on the next query */
+            dirty_views.push_back(view.get());
+            it = entries.find(view.get());
+        }
+
+        it->second.layer = layer;
+        it->second.stack_position = stack_position;
+    }
+
+    void remove(wayfire_view view)
+    {
+        auto it = entries.find(view.get());
+        if (it == entries.end())
+            return;
+
+        auto& entry = it->second;
+        view->disconnect_signal(wf::signals::damaged_region, &entry.on_damage);
+        if (entry.dirty)
+        {
+            dirty_views.erase(std::remove(dirty_views.begin(),
+                    dirty_views.end(), view.get()), dirty_views.end());
+        }
+
+        /* Dirty entries which haven't been indexed yet aren't in the cells or
+         * in the shell views, so nothing happens for them */
+        remove_from_cells(entry);
+        entries.erase(it);
+    }
+
+    /* Returns the views in the given layers whose bounding box or WM geometry
+     * intersects the box, and all shell views in these layers, ordered from
+     * the topmost to the bottommost one */
+    std::vector<wayfire_view> query(const wf_geometry& box, uint32_t layers_mask)
+    {
+        flush();
+
+        std::vector<entry_t*> found;
+        auto check = [&] (wayfire_view_t *ptr)
+        {
+            auto& entry = entries.at(ptr);
+            if (((1 << entry.layer) & layers_mask) && (entry.box & box))
+                found.push_back(&entry);
+        };
+
+        int cx1 = cell_coordinate(box.x);
+        int cy1 = cell_coordinate(box.y);
+        int cx2 = cell_coordinate(box.x + std::max(box.width, 1) - 1);
+        int cy2 = cell_coordinate(box.y + std::max(box.height, 1) - 1);
+        for (int cx = cx1; cx <= cx2; cx++)
+        {
+            for (int cy = cy1; cy <= cy2; cy++)
+            {
+                auto it = cells.find(cell_key(cx, cy));
+                if (it == cells.end())
+                    continue;
+
+                for (auto ptr : it->second)
+                    check(ptr);
+            }
+        }
+
+        /* A view which spans several cells was found once for each cell */
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+
+        /* Shell views are on every workspace, so their box can't be checked
+         * against a box on another workspace */
+        for (auto ptr : shell_views)
+        {
+            auto& entry = entries.at(ptr);
+            if ((1 << entry.layer) & layers_mask)
+                found.push_back(&entry);
+        }
+
+        std::sort(found.begin(), found.end(), [] (entry_t *a, entry_t *b)
+        {
+            if (a->layer != b->layer)
+                return a->layer > b->layer;
+            return a->stack_position > b->stack_position;
+        });
+
+        std::vector<wayfire_view> views;
+        views.reserve(found.size());
+        for (auto entry : found)
+            views.push_back(entry->view);
+
+        return views;
+    }
+};
+
 class viewport_manager : public workspace_manager
 {
     struct custom_viewport_layer_data_t : public wf_custom_data_t
@@ -25,6 +270,10 @@ class viewport_manager : public workspace_manager
         uint32_t layer = 0;
     };
 
+    view_spatial_index_t view_index;
+    /* Incremented each time a view is put on top of a layer */
+    uint64_t stack_counter = 0;
+
     uint32_t& _get_view_layer(wayfire_view view)
     {
         return view->get_data_safe<custom_viewport_layer_data_t>()->layer;
@@ -64,6 +313,7 @@ class viewport_manager : public workspace_manager
 
         std::vector<wayfire_view>
             get_views_on_workspace(std::tuple<int, int> ws, uint32_t layer_mask, bool wm_only);
+        std::vector<wayfire_view> get_views_at(wf_point point, uint32_t layer_mask);
         void for_each_view(view_callback_proc_t call, uint32_t layers_mask);
         void for_each_view_reverse(view_callback_proc_t call, uint32_t layers_mask);
 
@@ -175,6 +425,7 @@ void viewport_manager::_add_view_to_layer(wayfire_view view, uint32_t layer)
             remove_from_layer(view, layer_index_from_mask(current_layer));
 
         current_layer = 0;
+        view_index.remove(view);
         return;
     }
 
@@ -194,7 +445,12 @@ void viewport_manager::_add_view_to_layer(wayfire_view view, uint32_t layer)
     auto& layer_container = layers[layer_index_from_mask(layer)];
     layer_container.push_front(view);
     current_layer = layer;
+    view_index.update(view, layer_index_from_mask(layer), ++stack_counter);
     view->damage();
+
+    view_restacked_signal data;
+    data.view = view;
+    output->emit_signal("view-restacked", &data);
 }
 
 void viewport_manager::add_view_to_layer(wayfire_view view, uint32_t layer)
@@ -413,23 +669,27 @@ viewport_manager::get_views_on_workspace(std::tuple<int, int> vp,
                                          uint32_t layers_mask, bool wm_only)
 {
 
-    std::vector<wayfire_view> views;
+    GetTuple(tx, ty, vp);
+    auto g = output->get_relative_geometry();
+    g.x += (tx - vx) * g.width;
+    g.y += (ty - vy) * g.height;
 
-    for (int i = WF_TOTAL_LAYERS - 1; i >= 0; i--)
-    {
-        if ((1 << i) & layers_mask)
-        {
-            for (auto v : layers[i])
-            {
-                if (view_visible_on(v, vp, !wm_only))
-                    views.push_back(v);
-            }
-        }
-    }
+    /* The index returns all views which might be visible */
+    auto views = view_index.query(g, layers_mask);
+    auto it = std::remove_if(views.begin(), views.end(), [&] (wayfire_view v) {
+        return !view_visible_on(v, vp, !wm_only);
+    });
+    views.erase(it, views.end());
 
     return views;
 }
 
+std::vector<wayfire_view>
+viewport_manager::get_views_at(wf_point point, uint32_t layers_mask)
+{
+    return view_index.query({point.x, point.y, 1, 1}, layers_mask);
+}
+
 wf_geometry viewport_manager::get_workarea()
 {
     return current_workarea;
@@ -4,6 +4,9 @@
 #include <cstdio>
 #include <signal-definitions.hpp>
 #include <assert.h>
+#include <algorithm>
+#include <unordered_map>
+#include "substring-matcher.hpp"
 
 using std::string;
 
@@ -48,75 +51,59 @@ static bool ends_with(string x, string y)
     return x.length() >= y.length() && x.substr(x.length() - y.length()) == y;
 }
 
-
 class wayfire_window_rules : public wayfire_plugin_t
 {
+    enum rule_event
+    {
+        EVENT_CREATED      = 0,
+        EVENT_MAXIMIZED    = 1,
+        EVENT_FULLSCREENED = 2,
+        EVENT_TOTAL        = 3,
+    };
 
+    const std::vector<std::pair<string, rule_event>> events = {
+        {"created", EVENT_CREATED},
+        {"maximized", EVENT_MAXIMIZED},
+        {"fullscreened", EVENT_FULLSCREENED},
+    };
 
-    using verification_func = std::function<bool(wayfire_view, std::string)>;
-
-    struct verificator
+    enum rule_field
     {
-        verification_func func;
-        std::string atom;
+        FIELD_TITLE  = 0,
+        FIELD_APP_ID = 1,
+        FIELD_TOTAL  = 2,
     };
 
-    std::vector<verificator> verficators =
+    struct predicate_type
     {
-        {  [] (wayfire_view view, std::string match) -> bool
-            {
-                auto title = view->get_title();
-                return title.find(match) != std::string::npos;
-            },
-            "title contains"
-        },
-        { [] (wayfire_view view, std::string match) -> bool
-            {
-                auto title = view->get_title();
-                return title == match;
-            },
-            "title"
-        },
-        {  [] (wayfire_view view, std::string match) -> bool
-            {
-                auto app_id = view->get_app_id();
-                return app_id.find(match) != std::string::npos;
-            },
-            "app-id contains"
-        },
-        {  [] (wayfire_view view, std::string match) -> bool
-            {
-                auto app_id = view->get_app_id();
-                return app_id == match;
-            },
-            "app-id"
-        },
+        std::string atom;
+        rule_field field;
+        bool contains;
     };
 
-    std::vector<std::string> events = {
-        "created", "maximized", "fullscreened"
+    /* Longer atoms first, so that "title contains" isn't parsed as "title" */
+    const std::vector<predicate_type> predicates = {
+        {"title contains", FIELD_TITLE, true},
+        {"title", FIELD_TITLE, false},
+        {"app-id contains", FIELD_APP_ID, true},
+        {"app-id", FIELD_APP_ID, false},
     };
 
     using action_func = std::function<void(wayfire_view view)>;
 
-    struct lambda_executor
-    {
-        verification_func verify;
-        std::string verification_string;
-        action_func action;
-    };
-
-    using rule_func = std::function<void(wayfire_view)>;
     struct rule
     {
-        std::string signal;
-        std::function<void(wayfire_view)> func;
+        rule_event event;
+        rule_field field;
+        bool contains;
+        std::string match;
+        action_func action;
     };
 
-    rule parse_add_rule(std::string rule)
+    /* Returns false if the rule is invalid */
+    bool parse_rule(std::string rule, struct rule& result)
     {
         std::string predicate, action;
-        struct rule result;
 
         size_t pos = 0;
         for (; pos < rule.size() - 2; ++pos)
@@ -127,40 +114,40 @@ class wayfire_window_rules : public wayfire_plugin_t
 
         /* first condition is so that there is no underflow in unsigned arithmetic */
         if (rule.size() <= 5 || pos >= rule.size() - 2 || pos < 1)
-            return result;
+            return false;
 
         predicate = trim(rule.substr(0, pos));
-        std::string event;
         action = trim(rule.substr(pos + 2, rule.size() - pos - 1));
 
-        for (auto ev : events)
+        bool has_event = false;
+        for (auto& ev : events)
         {
-            if (ends_with(predicate, ev))
+            if (ends_with(predicate, ev.first))
             {
-                event = ev;
-                predicate = trim(predicate.substr(0, predicate.length() - ev.length()));
+                result.event = ev.second;
+                predicate = trim(predicate.substr(0,
+                        predicate.length() - ev.first.length()));
+                has_event = true;
                 break;
             }
         }
 
-        lambda_executor exec;
-        exec.verify = nullptr;
-        exec.action = nullptr;
-
-        for (const auto& pred : verficators)
+        bool has_predicate = false;
+        for (const auto& pred : predicates)
         {
             if (starts_with(predicate, pred.atom))
             {
-                exec.verify = pred.func;
-                exec.verification_string =
-                    trim(predicate.substr(pred.atom.length(),
-                                          predicate.length() - pred.atom.length()));
+                result.field = pred.field;
+                result.contains = pred.contains;
+                result.match = trim(predicate.substr(pred.atom.length(),
+                        predicate.length() - pred.atom.length()));
+                has_predicate = true;
                 break;
             }
         }
 
-        if (!exec.verify || !event.length())
-            return result;
+        if (!has_predicate || !has_event)
+            return false;
 
         if (starts_with(action, "move"))
         {
@@ -168,9 +155,9 @@ class wayfire_window_rules : public wayfire_plugin_t
             int t = std::sscanf(action.c_str(), "move %d %d", &x, &y);
 
             if (t != 2)
-                return result;
+                return false;
 
-            exec.action = [x,y] (wayfire_view view) {
+            result.action = [x,y] (wayfire_view view) {
                 auto og = view->get_output()->get_relative_geometry();
                 view->move(og.x + x, og.y + y);
             };
@@ -180,9 +167,9 @@ class wayfire_window_rules : public wayfire_plugin_t
             int t = std::sscanf(action.c_str(), "resize %d %d", &w, &h);
 
             if (t != 2 || w <= 0 || h <= 0)
-                return result;
+                return false;
 
-            exec.action = [w,h] (wayfire_view view) mutable {
+            result.action = [w,h] (wayfire_view view) mutable {
                 GetTuple(sw, sh, view->get_output()->get_screen_size());
                 if (w > 100000)
                     w = sw;
@@ -192,7 +179,7 @@ class wayfire_window_rules : public wayfire_plugin_t
             };
         } else if (ends_with(action, "set maximized"))
         {
-            exec.action = [action] (wayfire_view view)
+            result.action = [action] (wayfire_view view)
             {
                 view_maximized_signal data;
                 data.view = view;
@@ -203,7 +190,7 @@ class wayfire_window_rules : public wayfire_plugin_t
 
         else if (ends_with(action, "set fullscreen"))
         {
-            exec.action = [action] (wayfire_view view)
+            result.action = [action] (wayfire_view view)
             {
                 view_fullscreen_signal data;
                 data.view = view;
@@ -212,38 +199,92 @@ class wayfire_window_rules : public wayfire_plugin_t
             };
         }
 
+        return bool(result.action);
+    }
+
+    std::vector<rule> rules;
+
+    /* The rules of a single event, indexed by the value they match against.
+     * The vectors contain indices in rules. */
+    struct rule_index
+    {
+        std::unordered_map<std::string, std::vector<int>> exact[FIELD_TOTAL];
+        substring_matcher_t contains[FIELD_TOTAL];
+        /* Rules which match an empty substring always apply */
+        std::vector<int> always;
+        bool empty = true;
+    };
+
+    rule_index index[EVENT_TOTAL];
+
+    void build_index()
+    {
+        for (int i = 0; i < (int)rules.size(); i++)
+        {
+            auto& r = rules[i];
+            auto& idx = index[r.event];
+            idx.empty = false;
+
+            if (!r.contains)
+                idx.exact[r.field][r.match].push_back(i);
+            else if (r.match.empty())
+                idx.always.push_back(i);
+            else
+                idx.contains[r.field].add(r.match, i);
+        }
+
+        for (auto& idx : index)
+        {
+            for (auto& matcher : idx.contains)
+                matcher.build();
+        }
+    }
 
-        if (!exec.action)
-            return result;
+    /* Apply the rules of the given event which match the view, in the order
+     * they are listed in the config */
+    void apply_rules(rule_event event, wayfire_view view)
+    {
+        auto& idx = index[event];
+        if (idx.empty)
+            return;
 
-        result.signal = event;
-        result.func = [exec] (wayfire_view view)
+        std::vector<int> matched = idx.always;
+        std::string values[FIELD_TOTAL] = {view->get_title(), view->get_app_id()};
+        for (int field = 0; field < FIELD_TOTAL; field++)
         {
-            if (exec.verify(view, exec.verification_string))
-                exec.action(view);
-        };
+            auto it = idx.exact[field].find(values[field]);
+            if (it != idx.exact[field].end())
+                matched.insert(matched.end(), it->second.begin(), it->second.end());
 
-        return result;
+            idx.contains[field].find_all(values[field], matched);
+        }
+
+        /* A pattern can be found several times in the same text */
+        std::sort(matched.begin(), matched.end());
+        matched.erase(std::unique(matched.begin(), matched.end()), matched.end());
+
+        for (int i : matched)
+            rules[i].action(view);
     }
 
     signal_callback_t created, maximized, fullscreened;
 
-    std::map<std::string, std::vector<rule_func>> rules_list;
-
     public:
     void init(wayfire_config *config)
     {
         auto section = config->get_section("window-rules");
         for (auto opt : section->options)
         {
-            auto rule = parse_add_rule(opt->as_string());
-            rules_list[rule.signal].push_back(rule.func);
+            rule r;
+            if (parse_rule(opt->as_string(), r))
+                rules.push_back(std::move(r));
         }
 
+        build_index();
+
         created = [=] (signal_data *data)
         {
-            for (const auto& rule : rules_list["created"])
-                rule(get_signaled_view(data));
+            apply_rules(EVENT_CREATED, get_signaled_view(data));
         };
         output->connect_signal("map-view", &created);
 
@@ -255,8 +296,7 @@ class wayfire_window_rules : public wayfire_plugin_t
             if (!conv->state)
                 return;
 
-            for (const auto& rule : rules_list["maximized"])
-                rule(conv->view);
+            apply_rules(EVENT_MAXIMIZED, conv->view);
         };
         output->connect_signal("view-maximized", &maximized);
 
@@ -268,8 +308,7 @@ class wayfire_window_rules : public wayfire_plugin_t
             if (!conv->state)
                 return;
 
-            for (const auto& rule : rules_list["fullscreened"])
-                rule(conv->view);
+            apply_rules(EVENT_FULLSCREENED, conv->view);
         };
         output->connect_signal("view-fullscreen", &fullscreened);
     }
@@ -3,6 +3,7 @@
 #include <opengl.hpp>
 #include <debug.hpp>
 #include <render-manager.hpp>
+#include <core.hpp>
 #include <animation.hpp>
 
 class wayfire_zoom_screen : public wayfire_plugin_t
@@ -10,6 +11,7 @@ class wayfire_zoom_screen : public wayfire_plugin_t
 
     post_hook_t hook;
     axis_callback axis;
+    signal_callback_t pointer_motion;
 
     wf_option speed, modifier, smoothing_duration;
 
@@ -34,6 +36,13 @@ class wayfire_zoom_screen : public wayfire_plugin_t
             modifier = section->get_option("modifier", "<super>");
             output->add_axis(modifier, &axis);
 
+            /* The zoomed area follows the cursor, which may not be damaged
+             * at all if it is a hardware cursor */
+            pointer_motion = [=] (signal_data*)
+            {
+                output->render->schedule_redraw();
+            };
+
             speed    = section->get_option("speed", "0.005");
             smoothing_duration = section->get_option("smoothing_duration", "300");
 
@@ -53,12 +62,14 @@ class wayfire_zoom_screen : public wayfire_plugin_t
             {
                 auto current = duration.progress();
                 duration.start(current, target_zoom);
+                output->render->schedule_frames_until(
+                    get_current_time() + smoothing_duration->as_cached_int());
 
                 if (!hook_set)
                 {
                     hook_set = true;
                     output->render->add_post(&hook);
-                    output->render->auto_redraw(true);
+                    core->connect_signal("pointer-motion", &pointer_motion);
                 }
             }
         }
@@ -97,8 +108,8 @@ class wayfire_zoom_screen : public wayfire_plugin_t
 
             if (!duration.running() && current_zoom - 1 <= 0.01)
             {
-                output->render->auto_redraw(false);
                 output->render->rem_post(&hook);
+                core->disconnect_signal("pointer-motion", &pointer_motion);
                 hook_set = false;
             }
         }
@@ -106,7 +117,10 @@ class wayfire_zoom_screen : public wayfire_plugin_t
         void fini()
         {
             if (hook_set)
+            {
                 output->render->rem_post(&hook);
+                core->disconnect_signal("pointer-motion", &pointer_motion);
+            }
 
             output->rem_binding(&axis);
         }
@@ -401,44 +401,6 @@ modelStep (Model      *model,
     return wobbly;
 }
 
-static void
-bezierPatchEvaluate (Model *model,
-		     float u,
-		     float v,
-		     float *patchX,
-		     float *patchY)
-{
-    float coeffsU[4], coeffsV[4];
-    float x, y;
-    int   i, j;
-
-    coeffsU[0] = (1 - u) * (1 - u) * (1 - u);
-    coeffsU[1] = 3 * u * (1 - u) * (1 - u);
-    coeffsU[2] = 3 * u * u * (1 - u);
-    coeffsU[3] = u * u * u;
-
-    coeffsV[0] = (1 - v) * (1 - v) * (1 - v);
-    coeffsV[1] = 3 * v * (1 - v) * (1 - v);
-    coeffsV[2] = 3 * v * v * (1 - v);
-    coeffsV[3] = v * v * v;
-
-    x = y = 0.0f;
-
-    for (i = 0; i < 4; i++)
-    {
-	for (j = 0; j < 4; j++)
-	{
-	    x += coeffsU[i] * coeffsV[j] *
-		model->objects[j * GRID_WIDTH + i].position.x;
-	    y += coeffsU[i] * coeffsV[j] *
-		model->objects[j * GRID_HEIGHT + i].position.y;
-	}
-    }
-
-    *patchX = x;
-    *patchY = y;
-}
-
 static int
 wobblyEnsureModel(struct wobbly_surface *surface)
 {
@@ -600,51 +562,88 @@ wobbly_done_paint(struct wobbly_surface *surface)
     }
 }
 
+/* Bernstein polynomials of degree 3 at t, the weights of the control points
+ * of a cubic bezier curve */
+static void
+bezierCoefficients (float t, float *coeffs)
+{
+    coeffs[0] = (1 - t) * (1 - t) * (1 - t);
+    coeffs[1] = 3 * t * (1 - t) * (1 - t);
+    coeffs[2] = 3 * t * t * (1 - t);
+    coeffs[3] = t * t * t;
+}
+
 void
 wobbly_add_geometry(struct wobbly_surface *surface)
 {
     WobblyWindow *ww = surface->ww;
 
-    float    width, height;
-    float    deformedX, deformedY;
-    int      x, y, iw, ih;
-    float    cell_w, cell_h;
+    int      x, y, i, j, iw, ih, count;
+    float    coeffsV[4];
+    Point    column[4];
     GLfloat  *v, *uv;
 
-    if (ww->wobbly)
-    {
-	width  = surface->width;
-	height = surface->height;
+    if (!ww->wobbly)
+        return;
 
-	cell_w = width / surface->x_cells;
-	cell_h = height / surface->y_cells;
+    iw = surface->x_cells + 1;
+    ih = surface->y_cells + 1;
+    count = iw * ih;
 
-        iw = surface->x_cells + 1;
-        ih = surface->y_cells + 1;
+    /* The mesh and its texture coordinates change only with the grid size */
+    if (surface->vertex_count != count)
+    {
+        v = realloc(surface->v, sizeof(GLfloat) * 2 * count);
+        uv = realloc(surface->uv, sizeof(GLfloat) * 2 * count);
+        if (v)
+            surface->v = v;
+        if (uv)
+            surface->uv = uv;
+
+        if (!v || !uv)
+            return;
+
+        surface->vertex_count = count;
+        for (y = 0; y < ih; y++)
+        {
+            for (x = 0; x < iw; x++)
+            {
+                *uv++ = (float) x / surface->x_cells;
+                *uv++ = 1.0 - (float) y / surface->y_cells;
+            }
+        }
+    }
 
-	v = realloc(surface->v, sizeof(GLfloat) * 2 * iw * ih);
-	uv = realloc(surface->uv, sizeof(GLfloat) * 2 * iw * ih);
+    /* The weights of the control points along x are the same for each row */
+    float coeffsU[iw][4];
+    for (x = 0; x < iw; x++)
+        bezierCoefficients ((float) x / surface->x_cells, coeffsU[x]);
 
-	surface->v = v;
-	surface->uv = uv;
+    v = surface->v;
+    for (y = 0; y < ih; y++)
+    {
+        /* Collapse the patch into a cubic curve along x for this row, so that
+         * each vertex needs 4 instead of 16 control points */
+        bezierCoefficients ((float) y / surface->y_cells, coeffsV);
+        for (i = 0; i < 4; i++)
+        {
+            column[i].x = column[i].y = 0.0f;
+            for (j = 0; j < 4; j++)
+            {
+                column[i].x += coeffsV[j] *
+                    ww->model->objects[j * GRID_WIDTH + i].position.x;
+                column[i].y += coeffsV[j] *
+                    ww->model->objects[j * GRID_WIDTH + i].position.y;
+            }
+        }
 
-	for (y = 0; y < ih; y++)
-	{
-	    for (x = 0; x < iw; x++)
-	    {
-	        bezierPatchEvaluate (ww->model,
-	    			 (x * cell_w) / width,
-	    			 (y * cell_h) / height,
-	    			 &deformedX,
-	    			 &deformedY);
-
-	        *v++ = deformedX;
-	        *v++ = deformedY;
-
-	        *uv++ = (x * cell_w) / width;
-	        *uv++ = 1.0 - ((y * cell_h) / height);
-	    }
-	}
+        for (x = 0; x < iw; x++)
+        {
+            *v++ = coeffsU[x][0] * column[0].x + coeffsU[x][1] * column[1].x +
+                coeffsU[x][2] * column[2].x + coeffsU[x][3] * column[3].x;
+            *v++ = coeffsU[x][0] * column[0].y + coeffsU[x][1] * column[1].y +
+                coeffsU[x][2] * column[2].y + coeffsU[x][3] * column[3].y;
+        }
     }
 }
 
@@ -768,6 +767,7 @@ wobbly_fini(struct wobbly_surface *surface)
 	free(ww->model->objects);
 	free(ww->model);
 	free(surface->v);
+	free(surface->uv);
     }
 
     free (ww);
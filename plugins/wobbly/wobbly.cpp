@@ -51,7 +51,8 @@ void main()
             return;
 
         OpenGL::render_begin();
-        program = OpenGL::create_program_from_source(vertex_source, frag_source);
+        program = OpenGL::create_shared_program_from_source(
+            vertex_source, frag_source);
         uvID  = GL_CALL(glGetAttribLocation(program, "uvPosition"));
         posID = GL_CALL(glGetAttribLocation(program, "position"));
         mvpID = GL_CALL(glGetUniformLocation(program, "MVP"));
@@ -63,13 +64,93 @@ void main()
         if (--times_loaded == 0)
         {
             OpenGL::render_begin();
-            GL_CALL(glDeleteProgram(program));
+            OpenGL::destroy_program(program);
             OpenGL::render_end();
         }
     }
 
+    /* The GL buffers of a wobbly mesh. Positions are streamed once per frame,
+     * texture coordinates and indices change only with the grid size. */
+    struct mesh_t
+    {
+        GLuint pos = 0, uv = 0, idx = 0;
+        int vertex_count = 0, index_count = 0;
+    };
+
+    /* Requires bound opengl context */
+    void create_mesh(mesh_t& mesh, int x_cells, int y_cells)
+    {
+        int iw = x_cells + 1, ih = y_cells + 1;
+
+        std::vector<GLfloat> uv;
+        uv.reserve(2 * iw * ih);
+        for (int y = 0; y < ih; y++)
+        {
+            for (int x = 0; x < iw; x++)
+            {
+                uv.push_back(1.0f * x / x_cells);
+                uv.push_back(1.0f - 1.0f * y / y_cells);
+            }
+        }
+
+        std::vector<GLushort> idx;
+        idx.reserve(6 * x_cells * y_cells);
+        for (int y = 0; y < y_cells; y++)
+        {
+            for (int x = 0; x < x_cells; x++)
+            {
+                GLushort tl = y * iw + x, tr = tl + 1;
+                GLushort bl = tl + iw, br = bl + 1;
+
+                idx.insert(idx.end(), {tl, tr, br, tl, br, bl});
+            }
+        }
+
+        GL_CALL(glGenBuffers(1, &mesh.pos));
+        GL_CALL(glGenBuffers(1, &mesh.uv));
+        GL_CALL(glGenBuffers(1, &mesh.idx));
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.pos));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, uv.size() * sizeof(GLfloat),
+                NULL, GL_STREAM_DRAW));
+
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.uv));
+        GL_CALL(glBufferData(GL_ARRAY_BUFFER, uv.size() * sizeof(GLfloat),
+                uv.data(), GL_STATIC_DRAW));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.idx));
+        GL_CALL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, idx.size() * sizeof(GLushort),
+                idx.data(), GL_STATIC_DRAW));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+
+        mesh.vertex_count = iw * ih;
+        mesh.index_count = idx.size();
+    }
+
+    /* Requires bound opengl context */
+    void upload_mesh_positions(const mesh_t& mesh, const GLfloat *pos)
+    {
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.pos));
+        GL_CALL(glBufferSubData(GL_ARRAY_BUFFER, 0,
+                2 * mesh.vertex_count * sizeof(GLfloat), pos));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
+
+    /* Requires bound opengl context */
+    void destroy_mesh(mesh_t& mesh)
+    {
+        if (!mesh.pos)
+            return;
+
+        GL_CALL(glDeleteBuffers(1, &mesh.pos));
+        GL_CALL(glDeleteBuffers(1, &mesh.uv));
+        GL_CALL(glDeleteBuffers(1, &mesh.idx));
+        mesh = mesh_t{};
+    }
+
     /* Requires bound opengl context */
-    void render_triangles(GLuint tex, glm::mat4 mat, float *pos, float *uv, int cnt)
+    void render_mesh(GLuint tex, glm::mat4 mat, const mesh_t& mesh)
     {
         GL_CALL(glUseProgram(program));
         GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
@@ -80,21 +161,29 @@ void main()
         GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
         GL_CALL(glActiveTexture(GL_TEXTURE0));
 
-        GL_CALL(glVertexAttribPointer(posID, 2, GL_FLOAT, GL_FALSE, 0, pos));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.pos));
+        GL_CALL(glVertexAttribPointer(posID, 2, GL_FLOAT, GL_FALSE, 0, 0));
         GL_CALL(glEnableVertexAttribArray(posID));
 
-        GL_CALL(glVertexAttribPointer(uvID, 2, GL_FLOAT, GL_FALSE, 0, uv));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, mesh.uv));
+        GL_CALL(glVertexAttribPointer(uvID, 2, GL_FLOAT, GL_FALSE, 0, 0));
         GL_CALL(glEnableVertexAttribArray(uvID));
 
         GL_CALL(glUniformMatrix4fv(mvpID, 1, GL_FALSE, &mat[0][0]));
         GL_CALL(glEnable(GL_BLEND));
         GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
 
-        GL_CALL(glDrawArrays (GL_TRIANGLES, 0, 3 * cnt));
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.idx));
+        GL_CALL(glDrawElements(GL_TRIANGLES, mesh.index_count,
+                GL_UNSIGNED_SHORT, 0));
         GL_CALL(glDisable(GL_BLEND));
 
         GL_CALL(glDisableVertexAttribArray(uvID));
         GL_CALL(glDisableVertexAttribArray(posID));
+
+        /* Other code uses client-side vertex arrays */
+        GL_CALL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+        GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
     }
 };
 
@@ -141,6 +230,14 @@ class wf_wobbly : public wf_view_transformer_t
     wf_geometry snapped_geometry;
     uint32_t last_frame;
 
+    wobbly_graphics::mesh_t mesh;
+    /* Whether the positions in the mesh are out of date */
+    bool mesh_dirty = true;
+    /* Before the model has generated its first mesh, a flat grid covering
+     * this box is rendered */
+    wlr_box flat_box = {0, 0, 0, 0};
+    std::vector<GLfloat> flat_vertices;
+
     public:
     wf_wobbly(wayfire_view view, wayfire_grab_interface iface)
     {
@@ -157,11 +254,14 @@ class wf_wobbly : public wf_view_transformer_t
         model->grabbed = 0;
         model->synced = 1;
 
-        model->x_cells = wobbly_settings::resolution->as_cached_int();
-        model->y_cells = wobbly_settings::resolution->as_cached_int();
+        /* Indices are 16-bit, so the mesh can have at most 256x256 vertices */
+        int resolution = clamp(wobbly_settings::resolution->as_cached_int(), 1, 255);
+        model->x_cells = resolution;
+        model->y_cells = resolution;
 
         model->v = NULL;
         model->uv = NULL;
+        model->vertex_count = 0;
 
         last_frame = get_current_time();
         wobbly_init(model.get());
@@ -233,6 +333,7 @@ class wf_wobbly : public wf_view_transformer_t
 
         wobbly_add_geometry(model.get());
         wobbly_done_paint(model.get());
+        mesh_dirty = true;
 
         view->damage();
 
@@ -246,64 +347,52 @@ class wf_wobbly : public wf_view_transformer_t
             destroy_self();
     }
 
-    virtual void render_box(uint32_t src_tex, wlr_box src_box,
-        wlr_box scissor_box, const wf_framebuffer& target_fb)
+    /* Requires bound opengl context */
+    void update_mesh(wlr_box src_box)
     {
-        OpenGL::render_begin(target_fb);
-        target_fb.scissor(scissor_box);
+        if (!mesh.pos)
+            wobbly_graphics::create_mesh(mesh, model->x_cells, model->y_cells);
 
-        float x = src_box.x, y = src_box.y, w = src_box.width, h = src_box.height;
-
-        std::vector<float> vert, uv;
-        std::vector<int> idx;
-
-        int per_row = model->x_cells + 1;
-
-        for (int j = 0; j < model->y_cells; j++)
+        if (model->v && model->vertex_count == mesh.vertex_count)
         {
-            for (int i = 0; i < model->x_cells; i++)
-            {
-                idx.push_back(i * per_row + j);
-                idx.push_back((i + 1) * per_row + j + 1);
-                idx.push_back(i * per_row + j + 1);
-
-                idx.push_back(i * per_row + j);
-                idx.push_back((i + 1) * per_row + j);
-                idx.push_back((i + 1) * per_row + j + 1);
-            }
+            if (mesh_dirty)
+                wobbly_graphics::upload_mesh_positions(mesh, model->v);
+            mesh_dirty = false;
+            return;
         }
 
-        if (!model->v || !model->uv)
-        {
-            for (auto id : idx)
-            {
-                float tile_w = w / model->x_cells;
-                float tile_h = h / model->y_cells;
-
-                int i = id / per_row;
-                int j = id % per_row;
+        if (!mesh_dirty && src_box == flat_box)
+            return;
 
-                vert.push_back(i * tile_w + x);
-                vert.push_back(j * tile_h + y);
+        int iw = model->x_cells + 1, ih = model->y_cells + 1;
+        float tile_w = 1.0f * src_box.width / model->x_cells;
+        float tile_h = 1.0f * src_box.height / model->y_cells;
 
-                uv.push_back(1.0f * i / model->x_cells);
-                uv.push_back(1.0f - 1.0f * j / model->y_cells);
-            }
-        } else
+        flat_vertices.clear();
+        for (int y = 0; y < ih; y++)
         {
-            for (auto i : idx)
+            for (int x = 0; x < iw; x++)
             {
-                vert.push_back(model->v[2 * i]);
-                vert.push_back(model->v[2 * i + 1]);
-
-                uv.push_back(model->uv[2 * i]);
-                uv.push_back(model->uv[2 * i + 1]);
+                flat_vertices.push_back(src_box.x + x * tile_w);
+                flat_vertices.push_back(src_box.y + y * tile_h);
             }
         }
 
-        wobbly_graphics::render_triangles(src_tex,
-            target_fb.get_orthographic_projection(),
-            vert.data(), uv.data(), model->x_cells * model->y_cells * 2);
+        wobbly_graphics::upload_mesh_positions(mesh, flat_vertices.data());
+        flat_box = src_box;
+        mesh_dirty = false;
+    }
+
+    virtual void render_box(uint32_t src_tex, wlr_box src_box,
+        wlr_box scissor_box, const wf_framebuffer& target_fb)
+    {
+        OpenGL::render_begin(target_fb);
+        target_fb.scissor(scissor_box);
+
+        /* The mesh is uploaded only for the first box of the frame */
+        update_mesh(src_box);
+        wobbly_graphics::render_mesh(src_tex,
+            target_fb.get_orthographic_projection(), mesh);
 
         OpenGL::render_end();
     }
@@ -354,6 +443,7 @@ class wf_wobbly : public wf_view_transformer_t
     {
         wobbly_translate(model.get(), dx, dy);
         wobbly_add_geometry(model.get());
+        mesh_dirty = true;
     }
 
     void destroy_self()
@@ -378,6 +468,10 @@ class wf_wobbly : public wf_view_transformer_t
         wobbly_fini(model.get());
         view->get_output()->render->rem_effect(&pre_hook);
 
+        OpenGL::render_begin();
+        wobbly_graphics::destroy_mesh(mesh);
+        OpenGL::render_end();
+
         view->disconnect_signal("unmap", &view_removed);
         view->disconnect_signal("set-output", &view_output_changed);
         view->disconnect_signal("geometry-changed", &view_geometry_changed);
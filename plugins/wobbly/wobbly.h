@@ -24,6 +24,9 @@ struct wobbly_surface
    int x, y, width, height;
    int x_cells, y_cells;
    int grabbed, synced;
+   /* Number of vertices in v and uv, (x_cells + 1) * (y_cells + 1) once the
+    * mesh has been generated. The vertex at column x and row y is at index
+    * y * (x_cells + 1) + x */
    int vertex_count;
 
    GLfloat *v, *uv;
@@ -5,6 +5,7 @@
 #include "object.hpp"
 #include "input-device.hpp"
 #include "output-layout.hpp"
+#include "thread-pool.hpp"
 
 #include <functional>
 #include <memory>
@@ -87,6 +88,8 @@ class wayfire_core : public wf_object_base
         wlr_renderer *renderer;
         wlr_compositor *compositor;
         std::unique_ptr<wf::output_layout_t> output_layout;
+        /* Worker threads shared by core and plugins */
+        std::unique_ptr<wf::thread_pool_t> thread_pool;
 
         struct
         {
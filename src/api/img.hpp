@@ -4,14 +4,69 @@
 #include "debug.hpp"
 #include <GLES2/gl2.h>
 #include <string>
+#include <vector>
+#include <memory>
+#include <functional>
 
 namespace image_io
 {
+    /* Pixels of a decoded image, the first row is the top of the image */
+    struct decoded_image_t
+    {
+        int width = 0, height = 0;
+        /* GL_RGBA or GL_RGB, with 8 bits per channel */
+        GLenum format = GL_RGBA;
+        std::vector<uint8_t> pixels;
+    };
+
+    using image_callback_t = std::function<void()>;
+
+    /* A handle to an image which is decoded in the background, see load_async().
+     * Handles are cheap to copy, and all copies refer to the same image. */
+    class image_future_t
+    {
+        public:
+        image_future_t() {}
+
+        /* Whether the handle refers to an image at all */
+        bool valid() const;
+        /* Whether decoding has finished, successfully or not */
+        bool ready() const;
+        /* Whether decoding has finished successfully */
+        bool succeeded() const;
+
+        /* The decoded image. Must be called only if succeeded() */
+        const decoded_image_t& get() const;
+
+        /* Upload the image to the given GL texture target, like
+         * load_from_file(). Returns false if the image isn't decoded (yet). */
+        bool upload(GLuint target) const;
+
+        /* The callback is called on the main thread once decoding is
+         * finished. If it already is, the callback is called immediately.
+         * The callback must stay valid until it is called or removed. */
+        void add_ready_callback(image_callback_t *callback) const;
+        void rem_ready_callback(image_callback_t *callback) const;
+
+        struct state_t;
+
+        private:
+        std::shared_ptr<state_t> state;
+        friend image_future_t load_async(std::string name);
+    };
+
     /* Load the image from the given file, binding it to the given GL texture target
      * Bind the texture before you call this function
      * Guaranteed: doesn't change any GL state except pixel packing */
     bool load_from_file(std::string name, GLuint target);
 
+    /* Start decoding the image from the given file on a worker thread.
+     *
+     * Decoded images are cached while there are handles to them, so loading
+     * the same unchanged file again, e.g from another output, doesn't decode
+     * it a second time. */
+    image_future_t load_async(std::string name);
+
     /* Function that saves the given pixels(in rgba format) to a (currently) png file */
     void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type);
 
@@ -1,122 +1,185 @@
 #ifndef WF_SAFE_LIST_HPP
 #define WF_SAFE_LIST_HPP
 
-#include <list>
-#include <memory>
+#include <vector>
 #include <algorithm>
 #include <functional>
+#include <stdexcept>
 
-#include <wayland-server.h>
-
-#include "reverse.hpp"
-
-/* This is a trimmed-down wrapper of std::list<T>.
+/* A vector-backed list which supports safe iteration over all elements in the
+ * collection, where any element can be added or removed at any given time
+ * (i.e even in a for-each-like loop).
  *
- * It supports safe iteration over all elements in the collection, where any
- * element can be deleted from the list at any given time (i.e even in a
- * for-each-like loop) */
+ * Elements are stored contiguously, and the storage doesn't change while the
+ * list is being iterated, so iterations can pass elements by reference.
+ * Elements removed during an iteration are only marked as removed, and
+ * elements added during an iteration are kept aside. Both are applied when
+ * the outermost iteration finishes, so an iteration never visits elements
+ * added after it started. Outside of an iteration, changes are applied right
+ * away. */
 namespace wf
 {
-    /* The object type depends on the safe list type, and the safe list type
-     * needs access to the event loop. However, the event loop is typically
-     * available from core.hpp. Because we can't resolve this circular dependency,
-     * we provide a link to the event loop specially for the safe list */
-    namespace _safe_list_detail
-    {
-        /* In main.cpp, and initialized there */
-        extern wl_event_loop* event_loop;
-        void idle_cleanup_func(void *data);
-    }
-
     template<class T>
     class safe_list_t
     {
-        std::list<std::unique_ptr<T>> list;
-        wl_event_source *idle_cleanup_source = NULL;
+        struct slot_t
+        {
+            T value;
+            bool alive;
+        };
+
+        /* Iterating compacts the list at the end, and iterating is const */
+        mutable std::vector<slot_t> list;
 
-        /* Remove all invalidated elements in the list */
-        std::function<void()> do_cleanup = [&] ()
+        /* Number of iterations in progress */
+        mutable int iterating = 0;
+        /* Number of slots which were removed during an iteration */
+        mutable size_t removed = 0;
+
+        /* An element added during an iteration, to be inserted before the
+         * slot with the given index. Sorted by index, elements with the same
+         * index are in the order they will have in the list */
+        struct pending_t
+        {
+            size_t index;
+            T value;
+        };
+        mutable std::vector<pending_t> pending;
+
+        /* Insert pending elements and erase removed slots, if it is safe
+         * to do so */
+        void compact() const
         {
-            auto it = list.begin();
-            while (it != list.end())
+            if (iterating || (!removed && pending.empty()))
+                return;
+
+            std::vector<pending_t> inserted;
+            std::swap(inserted, pending);
+
+            std::vector<slot_t> result;
+            result.reserve(list.size() - removed + inserted.size());
+
+            /* Freeing an element may modify the list, so removed values are
+             * freed only after the list is consistent again */
+            std::vector<T> released;
+
+            size_t next = 0;
+            for (size_t i = 0; i < list.size(); i++)
             {
-                if (*it) {
-                    ++it;
-                } else {
-                    it = list.erase(it);
-                }
+                for (; next < inserted.size() && inserted[next].index <= i; next++)
+                    result.push_back({std::move(inserted[next].value), true});
+
+                if (list[i].alive)
+                    result.push_back(std::move(list[i]));
+                else
+                    released.push_back(std::move(list[i].value));
             }
 
-            idle_cleanup_source = NULL;
-        };
+            for (; next < inserted.size(); next++)
+                result.push_back({std::move(inserted[next].value), true});
+
+            list = std::move(result);
+            removed = 0;
+        }
 
-        /* Return whether the list has invalidated elements */
-        bool is_dirty() const
+        /* Insert value before the slot with the given index. During an
+         * iteration, the value is added after pending elements at the same
+         * index for which check returns INSERT_AFTER or INSERT_NONE */
+        template<class Check>
+        void insert_slot(size_t index, T&& value, Check check)
         {
-            return idle_cleanup_source;
+            if (!iterating)
+            {
+                list.insert(list.begin() + index, {std::move(value), true});
+                return;
+            }
+
+            auto it = std::lower_bound(pending.begin(), pending.end(), index,
+                [] (const pending_t& p, size_t idx) { return p.index < idx; });
+
+            /* Elements added at the same place during the iteration */
+            auto pos = it;
+            for (; it != pending.end() && it->index == index; ++it)
+            {
+                auto place = check(it->value);
+                if (place == INSERT_BEFORE)
+                    break;
+
+                pos = it + 1;
+                if (place == INSERT_AFTER)
+                    break;
+            }
+
+            pending.insert(pos, {index, std::move(value)});
         }
 
+        /* Marks the list as being iterated for the lifetime of the object */
+        struct iteration_guard_t
+        {
+            const safe_list_t *owner;
+            iteration_guard_t(const safe_list_t *owner) : owner(owner)
+            { ++owner->iterating; }
+
+            ~iteration_guard_t()
+            {
+                --owner->iterating;
+                owner->compact();
+            }
+        };
+
         public:
         safe_list_t() {};
 
-        /* Copy the not-erased elements from other, but do not copy the idle source */
+        /* Copy the not-erased elements from other */
         safe_list_t(const safe_list_t& other) { *this = other; }
         safe_list_t& operator = (const safe_list_t& other)
         {
-            this->idle_cleanup_source = NULL;
+            if (&other == this)
+                return *this;
+
+            list.clear();
+            pending.clear();
+            removed = 0;
             other.for_each([&] (auto& el) {
                 this->push_back(el);
             });
+
+            return *this;
         }
 
         safe_list_t(safe_list_t&& other) = default;
         safe_list_t& operator = (safe_list_t&& other) = default;
 
-        ~safe_list_t()
-        {
-            if (idle_cleanup_source)
-                wl_event_source_remove(idle_cleanup_source);
-        }
-
+        /* The last element, not counting elements added during the current
+         * iteration */
         T& back()
         {
-            /* No invalidated elements */
-            if (!is_dirty())
-                return *list.back();
-
-            auto it = list.rbegin();
-            while (it != list.rend() && (*it) == nullptr)
-                ++it;
+            auto it = std::find_if(list.rbegin(), list.rend(),
+                [] (const slot_t& slot) { return slot.alive; });
 
             if (it == list.rend())
                 throw std::out_of_range("back() called on an empty list!");
 
-            return **it;
+            return it->value;
         }
 
+        /* Includes the elements added during the current iteration */
         size_t size() const
         {
-            if (!is_dirty())
-                return list.size();
-
-            /* Count non-null elements, because that's the real size */
-            size_t sz = 0;
-            for (auto& it : list)
-                sz += (it != nullptr);
-
-            return sz;
+            return list.size() - removed + pending.size();
         }
 
         /* Push back by copying */
         void push_back(T value)
         {
-            list.push_back(std::make_unique<T> (std::move(value)));
+            emplace_back(std::move(value));
         }
 
         /* Push back by moving */
         void emplace_back(T&& value)
         {
-            list.push_back(std::make_unique<T> (value));
+            insert_slot(list.size(), std::move(value),
+                [] (const T&) { return INSERT_NONE; });
         }
 
         enum insert_place_t
@@ -128,99 +191,98 @@ namespace wf
 
         /* Insert the given value at a position in the list, determined by the
          * check function. The value is inserted at the first position that
-         * check indicates, or at the end of the list otherwise */
-        void emplace_at(T&& value, std::function<insert_place_t(T&)> check)
+         * check indicates, or at the end of the list otherwise.
+         *
+         * If the list is being iterated, the value is inserted when the
+         * iteration finishes. */
+        template<class Check>
+        void emplace_at(T&& value, Check check)
         {
-            auto it = list.begin();
-            while (it != list.end())
+            size_t index = list.size();
+            for (size_t i = 0; i < list.size(); i++)
             {
-                /* Skip empty elements */
-                if (*it == nullptr)
-                {
-                    ++it;
+                /* Skip removed elements */
+                if (!list[i].alive)
                     continue;
-                }
 
-                auto place = check(**it);
-                switch (place)
+                auto place = check(list[i].value);
+                if (place != INSERT_NONE)
                 {
-                    case INSERT_AFTER:
-                        /* We can safely increment it, because it points to an
-                         * element in the list */
-                        ++it;
-                        // fall through
-                    case INSERT_BEFORE:
-                        list.emplace(it, std::make_unique<T>(value));
-                        return;
-
-                    default:
-                        break;
+                    index = (place == INSERT_AFTER ? i + 1 : i);
+                    break;
                 }
-
-                ++it;
             }
 
-            /* If no place found, insert at the end */
-            emplace_back(std::move(value));
+            insert_slot(index, std::move(value), check);
         }
 
-        void insert_at(T value, std::function<insert_place_t(T&)> check)
+        template<class Check>
+        void insert_at(T value, Check check)
         {
             emplace_at(std::move(value), check);
         }
 
         /* Call func for each non-erased element of the list */
-        void for_each(std::function<void(T&)> func) const
+        template<class Func>
+        void for_each(Func func) const
         {
-            for (auto& el : list)
+            iteration_guard_t guard{this};
+            for (size_t i = 0; i < list.size(); i++)
             {
-                /* The for-each loop here is safe, because no elements will be
-                 * erased util the event loop goes idle */
-                if (el)
-                    func(*el);
+                if (list[i].alive)
+                    func(list[i].value);
             }
         }
 
         /* Call func for each non-erased element of the list in reversed order */
-        void for_each_reverse(std::function<void(T&)> func) const
+        template<class Func>
+        void for_each_reverse(Func func) const
         {
-            for (auto& el : wf::reverse(list))
+            iteration_guard_t guard{this};
+
+            for (size_t i = list.size(); i > 0; i--)
             {
-                /* The loop here is safe, because no elements will be erased
-                 * util the event loop goes idle */
-                if (el)
-                    func(*el);
+                if (list[i - 1].alive)
+                    func(list[i - 1].value);
             }
         }
 
         /* Safely remove all elements equal to value */
         void remove_all(const T& value)
         {
-            remove_if([=] (const T& el) { return el == value; });
+            remove_if([&] (const T& el) { return el == value; });
         }
 
-        /* Remove all elements satisfying a given condition.
-         * This function resets their pointers and scheduling a cleanup operation */
-        void remove_if(std::function<bool(const T&)> predicate)
+        /* Remove all elements satisfying a given condition. If the list is
+         * being iterated, the elements are freed after the iteration, because
+         * the iteration may still reference them */
+        template<class Predicate>
+        void remove_if(Predicate predicate)
         {
-            bool actually_removed = false;
-            for (auto& it : list)
+            /* Freeing an element may modify the list, so compact only after
+             * all elements have been checked */
+            iteration_guard_t guard{this};
+            for (size_t i = 0; i < list.size(); i++)
             {
-                if (it && predicate(*it))
+                if (list[i].alive && predicate(list[i].value))
                 {
-                    actually_removed = true;
-                    /* First reset the element in the list, and then free resources */
-                    auto copy = std::move(it);
-                    it = nullptr;
-                    /* Now copy goes out of scope */
+                    list[i].alive = false;
+                    ++removed;
                 }
             }
 
-            /* Schedule a clean-up, but be careful to not schedule it twice */
-            if (!idle_cleanup_source && actually_removed)
+            /* Elements added during the current iteration */
+            std::vector<T> released;
+            for (auto it = pending.begin(); it != pending.end();)
             {
-                idle_cleanup_source = wl_event_loop_add_idle(_safe_list_detail::event_loop,
-                    _safe_list_detail::idle_cleanup_func, &do_cleanup);
+                if (predicate(it->value))
+                {
+                    released.push_back(std::move(it->value));
+                    it = pending.erase(it);
+                } else
+                {
+                    ++it;
+                }
             }
         }
     };
@@ -3,6 +3,9 @@
 
 #include <unordered_map>
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 #include <typeinfo>
 
 #include <nonstd/observer_ptr.h>
@@ -17,32 +20,157 @@ class wf_custom_data_t
     virtual ~wf_custom_data_t() {};
 };
 
+/* An interned signal name.
+ *
+ * Each signal name is mapped to a small integer the first time it is used, so
+ * that connecting to and emitting a signal doesn't need to hash the name.
+ * Signals which are emitted often should be declared once as a wf_typed_signal
+ * instead of being looked up by name on each emit, see signal-definitions.hpp */
+class wf_signal_id
+{
+    public:
+    /* Intern the given name */
+    explicit wf_signal_id(const std::string& name);
+
+    /* Returns the ID of the given name, or an invalid ID if no signal with this
+     * name was ever interned. Doesn't intern the name. */
+    static wf_signal_id find(const std::string& name);
+
+    bool valid() const { return index != invalid_index; }
+    uint32_t get_index() const { return index; }
+    const std::string& get_name() const;
+
+    private:
+    static constexpr uint32_t invalid_index = UINT32_MAX;
+    wf_signal_id() = default;
+    uint32_t index = invalid_index;
+};
+
+/* An interned signal with a fixed payload type */
+template<class Data> class wf_typed_signal
+{
+    public:
+    using data_type = Data;
+    explicit wf_typed_signal(const std::string& name) : id(name) {}
+
+    const wf_signal_id id;
+};
+
 class wf_signal_provider_t
 {
     public:
 
     /* Register a callback to be called whenever the given signal is emitted */
-    void connect_signal(std::string name, signal_callback_t* callback)
+    void connect_signal(const wf_signal_id& id, signal_callback_t* callback)
     {
-        signals[name].push_back(callback);
+        if (id.get_index() >= signals.size())
+            signals.resize(id.get_index() + 1);
+
+        signals[id.get_index()].callbacks.push_back(callback);
     }
 
     /* Unregister a registered callback */
-    void disconnect_signal(std::string name, signal_callback_t* callback)
+    void disconnect_signal(const wf_signal_id& id, signal_callback_t* callback)
     {
-        signals[name].remove_all(callback);
+        if (!id.valid() || id.get_index() >= signals.size())
+            return;
+
+        auto& listeners = signals[id.get_index()];
+        auto& callbacks = listeners.callbacks;
+        if (listeners.emitting)
+        {
+            /* Callbacks are being iterated, just mark the callback as removed,
+             * emit_signal() will erase it afterwards */
+            std::replace(callbacks.begin(), callbacks.end(),
+                callback, (signal_callback_t*)nullptr);
+            listeners.dirty = true;
+        } else
+        {
+            callbacks.erase(std::remove(callbacks.begin(), callbacks.end(),
+                    callback), callbacks.end());
+        }
     }
 
     /* Emit the given signal. No type checking for data is required */
+    void emit_signal(const wf_signal_id& id, signal_data *data)
+    {
+        uint32_t idx = id.get_index();
+        if (idx >= signals.size() || signals[idx].callbacks.empty())
+            return;
+
+        /* Callbacks may connect or disconnect signals on this object, so
+         * the listener list is indexed again on each iteration */
+        ++signals[idx].emitting;
+        for (size_t i = 0; i < signals[idx].callbacks.size(); i++)
+        {
+            auto callback = signals[idx].callbacks[i];
+            if (callback)
+                (*callback) (data);
+        }
+
+        auto& listeners = signals[idx];
+        if (--listeners.emitting == 0 && listeners.dirty)
+        {
+            auto& callbacks = listeners.callbacks;
+            callbacks.erase(std::remove(callbacks.begin(), callbacks.end(),
+                    nullptr), callbacks.end());
+            listeners.dirty = false;
+        }
+    }
+
+    /* Typed variants, which check the type of the data at compile time */
+    template<class Data>
+    void connect_signal(const wf_typed_signal<Data>& signal,
+        signal_callback_t* callback)
+    {
+        connect_signal(signal.id, callback);
+    }
+
+    template<class Data>
+    void disconnect_signal(const wf_typed_signal<Data>& signal,
+        signal_callback_t* callback)
+    {
+        disconnect_signal(signal.id, callback);
+    }
+
+    template<class Data>
+    void emit_signal(const wf_typed_signal<Data>& signal,
+        typename wf_typed_signal<Data>::data_type *data)
+    {
+        emit_signal(signal.id, data);
+    }
+
+    /* String variants, for signals which aren't emitted very often */
+    void connect_signal(std::string name, signal_callback_t* callback)
+    {
+        connect_signal(wf_signal_id{name}, callback);
+    }
+
+    void disconnect_signal(std::string name, signal_callback_t* callback)
+    {
+        disconnect_signal(wf_signal_id::find(name), callback);
+    }
+
     void emit_signal(std::string name, signal_data *data)
     {
-        signals[name].for_each([data] (auto call) {
-            (*call) (data);
-        });
+        /* A signal which was never interned has no listeners */
+        auto id = wf_signal_id::find(name);
+        if (id.valid())
+            emit_signal(id, data);
     }
 
     private:
-    std::unordered_map<std::string, wf::safe_list_t<signal_callback_t*>> signals;
+    struct listener_list_t
+    {
+        std::vector<signal_callback_t*> callbacks;
+        /* Number of emit_signal() calls in progress for this signal */
+        int emitting = 0;
+        /* Whether there are removed callbacks to erase */
+        bool dirty = false;
+    };
+
+    /* Indexed by the signal ID */
+    std::vector<listener_list_t> signals;
 };
 
 class wf_object_base : public wf_signal_provider_t
@@ -16,6 +16,7 @@ extern "C"
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <map>
+#include <vector>
 
 class wayfire_output;
 using wf_geometry = wlr_box;
@@ -34,6 +35,7 @@ void gl_call(const char*, uint32_t, const char*);
 #define TEXTURE_TRANSFORM_INVERT_Y     (1 << 1)
 #define TEXTURE_TRANSFORM_USE_COLOR    (1 << 2)
 #define TEXTURE_USE_TEX_GEOMETRY       (1 << 4)
+#define TEXTURE_IGNORE_ALPHA           (1 << 5)
 
 struct gl_geometry
 {
@@ -43,6 +45,11 @@ struct gl_geometry
 /* Simple framebuffer, used mostly to allocate framebuffers for workspace
  * streams.
  *
+ * The texture and framebuffer are taken from a pool shared by all
+ * framebuffers, and returned there by release() or when allocate() changes
+ * the size, so that animations which create many temporary buffers don't
+ * have to create and destroy GL objects all the time.
+ *
  * Resources (tex/fb) are not automatically destroyed */
 struct wf_framebuffer_base : public noncopyable_t
 {
@@ -68,9 +75,10 @@ struct wf_framebuffer_base : public noncopyable_t
      * coordinate space */
     void scissor(wlr_box box) const;
 
-    /* Will destroy the texture and framebuffer
+    /* Will return the texture and framebuffer to the pool, which may destroy
+     * them if the pool is full.
      * Warning: will destroy tex/fb even if they have been allocated outside of
-     * allocate() */
+     * allocate(). Such buffers are destroyed instead of being pooled */
     void release();
 
     /* Reset the framebuffer, WITHOUT freeing resources.
@@ -79,6 +87,10 @@ struct wf_framebuffer_base : public noncopyable_t
 
     private:
     void copy_state(wf_framebuffer_base&& other);
+
+    /* The size of the texture created by allocate(), which is what the pool
+     * needs. The viewport may be changed by users after allocating */
+    int32_t allocated_width = 0, allocated_height = 0;
 };
 
 /* A more feature-complete framebuffer.
@@ -123,6 +135,76 @@ struct wf_framebuffer : public wf_framebuffer_base
     glm::mat4 get_orthographic_projection() const;
 };
 
+/* Collects textured quads and renders them with a few draw calls from a
+ * single vertex buffer, instead of a draw call with its own state setup for
+ * each quad, like OpenGL::render_transformed_texture().
+ *
+ * Quads are drawn in the order they are added, so that blending works as
+ * expected. Consecutive quads with the same texture are drawn together, so
+ * add all damage rectangles of a texture one after another.
+ *
+ * Quads which stay axis-aligned after their transform are clipped to their
+ * scissor box directly, the others need a separate draw for each scissor box.
+ *
+ * The batch is rendered by flush() or when it is destroyed. Both must happen
+ * between OpenGL::render_begin() and OpenGL::render_end() for the target */
+class wf_texture_batch : public noncopyable_t
+{
+    public:
+        wf_texture_batch(const wf_framebuffer_base& target);
+        ~wf_texture_batch();
+
+        /* The arguments are the same as for render_transformed_texture(), with
+         * the scissor box given in framebuffer coordinates like for
+         * wf_framebuffer_base::scissor(). Additionally, bits can contain
+         * TEXTURE_IGNORE_ALPHA for textures without alpha channel. */
+        void add_quad(GLuint tex, const gl_geometry& g, const gl_geometry& texg,
+            const glm::mat4& transform, const glm::vec4& color, uint32_t bits,
+            const wlr_box& scissor);
+
+        void flush();
+
+    private:
+        struct vertex_t
+        {
+            GLfloat position[4];
+            GLfloat uv[2];
+            GLfloat color[4];
+            GLfloat ignore_alpha;
+        };
+
+        struct draw_t
+        {
+            GLuint tex;
+            /* Whether the quads have been clipped to the scissor box already */
+            bool clipped;
+            wlr_box scissor;
+            size_t first, count;
+        };
+
+        int32_t viewport_width, viewport_height;
+        std::vector<vertex_t> vertices;
+        std::vector<draw_t> draws;
+
+        void push_quad(GLuint tex, const vertex_t quad[4], bool clipped,
+            const wlr_box& scissor);
+};
+
+/* Statistics of the framebuffer pool, see wf_framebuffer_base */
+struct wf_framebuffer_pool_stats
+{
+    /* Number of allocations served from the pool, and the rest */
+    uint64_t hits = 0, misses = 0;
+    /* Number of buffers destroyed to keep the pool under its size limit */
+    uint64_t evictions = 0;
+
+    /* Unused buffers currently kept in the pool and their memory */
+    size_t pooled_buffers = 0;
+    size_t pooled_bytes = 0;
+    /* The maximal size of the pool, as set by core/framebuffer_pool_size */
+    size_t max_bytes = 0;
+};
+
 namespace OpenGL
 {
     /* NOT API
@@ -170,11 +252,39 @@ namespace OpenGL
     /* Compiles the given shader source */
     GLuint compile_shader(std::string source, GLuint type);
 
+    /* Returns the current statistics of the framebuffer pool */
+    wf_framebuffer_pool_stats get_framebuffer_pool_stats();
+
+    /* Returns the contents of the given shader file */
+    std::string read_shader_source(std::string path);
+
+    /* The type of a shader, e.g GL_VERTEX_SHADER, and its source */
+    using shader_stage_t = std::pair<GLenum, std::string>;
+
+    /* Create a gl program from the given shader stages.
+     * Returns 0 if the program failed to compile or link */
+    GLuint create_program_from_stages(const std::vector<shader_stage_t>& stages);
+    /* Release a program created by any of the create_program functions */
+    void destroy_program(GLuint program);
+
     /* Create a very simple gl program from the given shader sources */
     GLuint create_program_from_source(std::string vertex_source,
         std::string frag_source);
     /* Same as create_program_from_source, but loads shaders from files */
     GLuint create_program(std::string vertex_path, std::string frag_path);
+
+    /* Same as the functions above, but the program is shared: plugins and
+     * outputs which use the same shader sources get the same program.
+     *
+     * Shared programs must be freed with destroy_program() and not with
+     * glDeleteProgram(). Uniform values are part of the program, so they
+     * are shared between all users as well: set every uniform which is used
+     * before each draw instead of only once after creating the program. */
+    GLuint create_shared_program_from_stages(
+        const std::vector<shader_stage_t>& stages);
+    GLuint create_shared_program_from_source(std::string vertex_source,
+        std::string frag_source);
+    GLuint create_shared_program(std::string vertex_path, std::string frag_path);
 }
 
 /* utils */
@@ -25,7 +25,6 @@ class wayfire_output : public wf_object_base
     friend class wayfire_core;
 
     private:
-       std::unordered_map<std::string, wf::safe_list_t<signal_callback_t*>> signals;
        std::unordered_multiset<wayfire_grab_interface> active_plugins;
 
        plugin_manager *plugin;
@@ -6,6 +6,9 @@
 #include "object.hpp"
 #include "util.hpp"
 #include <list>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
 
 /* Emitted whenever a workspace stream is being started or stopped */
 struct wf_stream_signal : public signal_data
@@ -18,6 +21,17 @@ struct wf_stream_signal : public signal_data
     const wf_framebuffer& fb;
 };
 
+namespace wf
+{
+    namespace signals
+    {
+        /* "workspace-stream-pre" and "workspace-stream-post", emitted on the
+         * render_manager around each repaint of a workspace stream */
+        extern const wf_typed_signal<wf_stream_signal> workspace_stream_pre;
+        extern const wf_typed_signal<wf_stream_signal> workspace_stream_post;
+    }
+}
+
 /* Workspace streams are used if you need to continuously render a workspace
  * to a texture, for example if you call texture_from_viewport at every frame */
 struct wf_workspace_stream
@@ -26,11 +40,77 @@ struct wf_workspace_stream
     wf_framebuffer_base buffer;
     bool running = false;
 
-    float scale_x, scale_y;
+    /* The scale the stream is rendered at, relative to the output resolution */
+    float scale_x = 1, scale_y = 1;
     /* The background color of the stream, when there is no view above it */
     wf_color background = {0.0f, 0.0f, 0.0f, 1.0f};
 };
 
+/* The phases of render_manager::paint(), in the order they are executed */
+enum wf_frame_phase
+{
+    WF_FRAME_PHASE_PRE_EFFECTS  = 0,
+    WF_FRAME_PHASE_MAKE_CURRENT = 1,
+    WF_FRAME_PHASE_RENDER       = 2,
+    WF_FRAME_PHASE_OVERLAY      = 3,
+    WF_FRAME_PHASE_SW_CURSORS   = 4,
+    WF_FRAME_PHASE_POST_EFFECTS = 5,
+    WF_FRAME_PHASE_SWAP_BUFFERS = 6,
+    WF_FRAME_PHASE_POST_PAINT   = 7,
+    WF_FRAME_PHASE_TOTAL        = 8
+};
+
+/* Timing information about a single repainted frame.
+ * All times are in microseconds, with CLOCK_MONOTONIC as a base */
+struct wf_frame_timing
+{
+    uint64_t frame_id = 0;
+    int64_t start = 0;
+    int64_t phase_time[WF_FRAME_PHASE_TOTAL] = {0};
+
+    /* Number of pixels which were swapped to the screen */
+    int64_t damaged_area = 0;
+    /* Number of (sub)surfaces which were repainted in workspace streams */
+    uint32_t surface_count = 0;
+
+    /* Time between the frame event and the start of the frame, as set by
+     * the max_render_time option. Client commits and input arriving in this
+     * time are shown a whole refresh cycle earlier than without the delay */
+    int64_t render_delay = 0;
+
+    /* Sum of all phase times */
+    int64_t total() const;
+};
+
+/* Emitted by the render_manager after each repainted frame, as "frame-timing" */
+struct wf_frame_timing_signal : public signal_data
+{
+    const wf_frame_timing *timing;
+};
+
+/* A fixed-size ring buffer which keeps the timings of the last frames.
+ *
+ * It isn't synchronized: like the rest of the render_manager, it may be
+ * accessed only from the main thread. */
+class wf_frame_timing_history
+{
+    public:
+        static constexpr size_t capacity = 256;
+
+        /* Add a new entry, overwriting the oldest one if the buffer is full */
+        void push(const wf_frame_timing& timing);
+
+        /* Returns the stored timings, the oldest first */
+        std::vector<wf_frame_timing> get_timings() const;
+
+        /* Returns the number of frames recorded since the output was created */
+        uint64_t get_total_frames() const;
+
+    private:
+        wf_frame_timing timings[capacity];
+        uint64_t head = 0;
+};
+
 enum wf_output_effect_type
 {
     WF_OUTPUT_EFFECT_PRE = 0,
@@ -52,6 +132,8 @@ using post_hook_t = std::function<void(const wf_framebuffer_base& source,
 using render_hook_t = std::function<void(const wf_framebuffer& fb)>;
 
 struct wf_output_damage;
+class wayfire_view_t;
+using wayfire_view = nonstd::observer_ptr<wayfire_view_t>;
 class render_manager : public wf_signal_provider_t
 {
     private:
@@ -80,8 +162,66 @@ class render_manager : public wf_signal_provider_t
 
         int constant_redraw = 0;
         int output_inhibit = 0;
+
+        /* See schedule_redraw() and schedule_frames_until() */
+        bool frame_requested = false;
+        uint32_t animation_deadline = 0;
+        /* Whether the current frame was started before the deadline */
+        bool animation_frame = false;
+        bool animation_running();
+
         render_hook_t renderer;
 
+        wf_frame_timing_history frame_timings;
+        /* Surfaces repainted in the current frame */
+        uint32_t frame_surface_count = 0;
+        void record_frame_timing(wf_frame_timing& timing);
+
+        /* Visibility of views on a workspace, as computed by the occlusion
+         * pass the last time the workspace was repainted */
+        struct ws_visibility_t
+        {
+            std::unordered_set<wayfire_view_t*> visible, occluded;
+        };
+        std::vector<std::vector<ws_visibility_t>> ws_visibility;
+        signal_callback_t view_detached, view_stacking_changed;
+        void reset_visibility();
+
+        /* Whether the view was fully occluded on the current workspace, or on
+         * all workspaces if all_workspaces is set */
+        bool is_view_occluded(wayfire_view_t *view, bool all_workspaces);
+
+        /* Hidden views get frame-done events at a lower rate, driven by a
+         * timer so that they don't depend on the output being repainted */
+        wf_option background_frame_rate;
+        wf_option_callback background_frame_rate_changed;
+        wf::wl_timer background_frame_timer;
+        /* The time in milliseconds when a view was last sent frame-done */
+        std::unordered_map<wayfire_view_t*, uint32_t> last_frame_done;
+
+        uint32_t get_background_frame_interval();
+        void schedule_background_frame_done();
+        void send_background_frame_done();
+        void send_frame_done(wayfire_view view, const timespec& now);
+
+        /* paint() is started as late as possible before the next vblank, so
+         * that it picks up the latest client content. The delay is computed
+         * from the refresh rate and the max_render_time option, which is
+         * either fixed or estimated from the recent paint() times */
+        wf_option max_render_time;
+        wf::wl_timer repaint_timer;
+        bool repaint_pending = false;
+        /* The frame event comes right after a vblank only if the last frame
+         * was swapped, otherwise it is sent as soon as a frame is scheduled */
+        bool last_frame_swapped = false;
+        int64_t frame_event_time = 0;
+        /* Slowest recent paint() time in microseconds, decays slowly */
+        int64_t render_time_estimate = 0;
+
+        void handle_frame();
+        /* Returns the time in microseconds to wait before painting */
+        int64_t get_render_delay();
+
         void paint();
         void post_paint();
 
@@ -100,10 +240,34 @@ class render_manager : public wf_signal_provider_t
         void reset_renderer();
 
         /* schedule repaint immediately after finishing the last one
-         * to undo, call auto_redraw(false) as much times as auto_redraw(true) was called */
+         * to undo, call auto_redraw(false) as much times as auto_redraw(true) was called
+         *
+         * This keeps the output repainting at display rate even if nothing
+         * changes, so prefer schedule_redraw() and schedule_frames_until() */
         void auto_redraw(bool redraw);
+
+        /* Request a single frame, for example after input which changes the
+         * state of a plugin. Plugins should damage what they change: only the
+         * damaged parts of the output are repainted, unless there is a custom
+         * renderer or a postprocessing effect, which are run for each frame */
         void schedule_redraw();
 
+        /* Schedule a frame without forcing custom renderers and effects to
+         * run. Only the damaged parts of the output are repainted, so this is
+         * what client commits use to get their frame callbacks */
+        void schedule_frame();
+
+        /* Keep scheduling frames until the given time, as returned by
+         * get_current_time(), is reached, for example for the duration of an
+         * animation. Requests are coalesced, the latest deadline is used.
+         *
+         * The last scheduled frame is the first one which starts at or after
+         * the deadline, so animations started before the call see their end.
+         *
+         * Like with schedule_redraw(), plugins still need to damage what
+         * they change */
+        void schedule_frames_until(uint32_t deadline);
+
         void add_inhibit(bool add);
 
         void add_effect(effect_hook_t*, wf_output_effect_type type);
@@ -137,7 +301,15 @@ class render_manager : public wf_signal_provider_t
 
         wf_framebuffer get_target_framebuffer() const;
 
-        void workspace_stream_start(wf_workspace_stream *stream);
+        /* Returns the timings of the last repainted frames, the oldest first.
+         * Listen for the "frame-timing" signal to get each frame as it is done */
+        std::vector<wf_frame_timing> get_frame_timings() const;
+
+        /* The scale is the size at which the stream is going to be shown,
+         * relative to the output. Streams which are shown downscaled are
+         * rendered at a lower resolution, see workspace_stream_update() */
+        void workspace_stream_start(wf_workspace_stream *stream,
+                float scale_x = 1, float scale_y = 1);
         void workspace_stream_update(wf_workspace_stream *stream,
                 float scale_x = 1, float scale_y = 1);
         void workspace_stream_stop(wf_workspace_stream *stream);
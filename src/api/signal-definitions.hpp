@@ -20,6 +20,10 @@ using unmap_view_signal      = _view_signal;
  * or unmapped */
 using view_disappeared_signal = _view_signal;
 
+/* "view-restacked", emitted on the output when the view changes its layer or
+ * its position in the stacking order, for ex. when it is brought to front */
+using view_restacked_signal = _view_signal;
+
 using focus_view_signal      = _view_signal;
 using view_set_parent_signal = _view_signal;
 using move_request_signal    = _view_signal;
@@ -37,6 +41,21 @@ struct view_geometry_changed_signal : public _view_signal
     wf_geometry old_geometry;
 };
 
+/* Signals which are emitted many times per frame, interned at startup.
+ * Listeners can still connect to them by name. */
+namespace wf
+{
+    namespace signals
+    {
+        /* "view-geometry-changed", emitted on the output */
+        extern const wf_typed_signal<view_geometry_changed_signal> view_geometry_changed;
+        /* "geometry-changed", emitted on the view itself */
+        extern const wf_typed_signal<view_geometry_changed_signal> geometry_changed;
+        /* "damaged-region", emitted on the view when it is damaged, has no data */
+        extern const wf_typed_signal<signal_data> damaged_region;
+    }
+}
+
 struct _view_state_signal : public _view_signal
 {
     bool state;
@@ -0,0 +1,99 @@
+#ifndef WF_THREAD_POOL_HPP
+#define WF_THREAD_POOL_HPP
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <nonstd/noncopyable.hpp>
+
+extern "C"
+{
+#include <wayland-server.h>
+}
+
+namespace wf
+{
+    /**
+     * A pool of worker threads, owned by core and created once at startup.
+     *
+     * It is meant for CPU-heavy work which doesn't touch the compositor
+     * state, like updating particles, rendering text with cairo or decoding
+     * images. Tasks must not call into core, outputs, views or GL.
+     */
+    class thread_pool_t : public noncopyable_t
+    {
+        public:
+        using task_t = std::function<void()>;
+        using range_func_t = std::function<void(int, int)>;
+
+        /** A set of async tasks which can be waited for together, usually
+         * all tasks of a plugin. It must outlive its tasks. */
+        class async_group_t : public noncopyable_t
+        {
+            friend class thread_pool_t;
+            /* Tasks which haven't finished their work yet, protected by
+             * the pool's finished_lock */
+            int running = 0;
+        };
+
+        /** Create the workers. If num_workers is 0 or less, a worker is created
+         * for each CPU core except the one used by the main thread.
+         * Callbacks of run_async() are dispatched from the given loop. */
+        thread_pool_t(wl_event_loop *loop, int num_workers);
+        /** Waits for the running tasks and drops the queued ones */
+        ~thread_pool_t();
+
+        int get_num_workers() const;
+
+        /** Split [begin, end) into ranges of at least grain elements and call
+         * func(range_begin, range_end) for each of them in parallel.
+         *
+         * The calling thread takes part in the work, and the function returns
+         * when all ranges have been processed. */
+        void parallel_for(int begin, int end, int grain, const range_func_t& func);
+
+        /** Run work on a worker thread. When it is done, done is called on the
+         * main thread, from the event loop. done may be null.
+         *
+         * If group is given, the task can be waited for with wait_async() */
+        void run_async(task_t work, task_t done = nullptr,
+            async_group_t *group = nullptr);
+
+        /** Wait for the tasks of the given group and call their done
+         * callbacks. Plugins need this before they are unloaded, because the
+         * tasks and callbacks run code from the plugin.
+         *
+         * Without a group, wait for all tasks started with run_async() */
+        void wait_async(async_group_t *group = nullptr);
+
+        /** Dispatch the done callbacks of finished async tasks.
+         * Do not use manually, called from the event loop */
+        void dispatch_finished(async_group_t *group = nullptr);
+
+        private:
+        std::vector<std::thread> workers;
+
+        std::mutex queue_lock;
+        std::condition_variable queue_cond;
+        std::deque<task_t> queue;
+        bool stopping = false;
+
+        /* Done callbacks of finished async tasks, and the eventfd used to
+         * wake up the event loop */
+        std::mutex finished_lock;
+        std::condition_variable finished_cond;
+        std::vector<std::pair<async_group_t*, task_t>> finished;
+        /* Number of async tasks which haven't finished their work yet */
+        int async_running = 0;
+        int finished_fd = -1;
+        wl_event_source *finished_source = nullptr;
+
+        void push_task(task_t task);
+        void worker_loop();
+    };
+}
+
+#endif /* end of include guard: WF_THREAD_POOL_HPP */
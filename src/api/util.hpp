@@ -49,6 +49,15 @@ wf_geometry wf_geometry_intersection(const wf_geometry& r1,
     const wf_geometry& r2);
 
 /* ---------------------- pixman utility functions -------------------------- */
+
+/* A region of non-overlapping rectangles, backed by a pixman region.
+ *
+ * pixman keeps empty and single-rectangle regions inline, without a heap
+ * allocation. The operators below check the extents of their operands first,
+ * so that the common cases (disjoint boxes, a box covering the whole region,
+ * single-rectangle operands) don't go through the generic pixman path and
+ * keep the result inline when possible. Operators called on a temporary
+ * reuse its storage instead of allocating a new region. */
 struct wf_region
 {
     wf_region();
@@ -70,27 +79,35 @@ struct wf_region
     pixman_box32_t get_extents() const;
 
     /* Translate the region */
-    wf_region operator + (const wf_point& vector) const;
+    wf_region operator + (const wf_point& vector) const &;
+    wf_region operator + (const wf_point& vector) &&;
     wf_region& operator += (const wf_point& vector);
 
-    wf_region operator * (float scale) const;
+    wf_region operator * (float scale) const &;
+    wf_region operator * (float scale) &&;
     wf_region& operator *= (float scale);
 
     /* Region intersection */
-    wf_region operator & (const wlr_box& box) const;
-    wf_region operator & (const wf_region& other) const;
+    wf_region operator & (const wlr_box& box) const &;
+    wf_region operator & (const wlr_box& box) &&;
+    wf_region operator & (const wf_region& other) const &;
+    wf_region operator & (const wf_region& other) &&;
     wf_region& operator &= (const wlr_box& box);
     wf_region& operator &= (const wf_region& other);
 
     /* Region union */
-    wf_region operator | (const wlr_box& other) const;
-    wf_region operator | (const wf_region& other) const;
+    wf_region operator | (const wlr_box& other) const &;
+    wf_region operator | (const wlr_box& other) &&;
+    wf_region operator | (const wf_region& other) const &;
+    wf_region operator | (const wf_region& other) &&;
     wf_region& operator |= (const wlr_box& other);
     wf_region& operator |= (const wf_region& other);
 
     /* Subtract the box/region from the current region */
-    wf_region operator ^ (const wlr_box& box) const;
-    wf_region operator ^ (const wf_region& other) const;
+    wf_region operator ^ (const wlr_box& box) const &;
+    wf_region operator ^ (const wlr_box& box) &&;
+    wf_region operator ^ (const wf_region& other) const &;
+    wf_region operator ^ (const wf_region& other) &&;
     wf_region& operator ^= (const wlr_box& box);
     wf_region& operator ^= (const wf_region& other);
 
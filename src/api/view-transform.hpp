@@ -4,6 +4,7 @@
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
 
 #include "view.hpp"
 #include "opengl.hpp"
@@ -35,6 +36,20 @@ class wf_view_transformer_t
         /* return the boundingbox of region after applying all transformations */
         virtual wlr_box get_bounding_box(wf_geometry view, wlr_box region);
 
+        /* return the region which needs to be repainted in the transformed view
+         * when the given region of the view changes. The default
+         * implementation takes the bounding box of each rectangle */
+        virtual wf_region transform_damage(wf_geometry view, const wf_region& damage);
+
+        /* return true if the result of the transform has changed since the
+         * last call only where its input was damaged, as given by
+         * transform_damage(). If so, the view keeps the result of the
+         * transform between frames and repaints only the damaged parts.
+         *
+         * Transformers which are animated or depend on anything else than
+         * their input, must return false. This is the default */
+        virtual bool is_damage_preserving() { return false; }
+
         /* src_tex        the internal FBO texture,
          *
          * src_box        box of the view that has to be repainted, contains
@@ -87,8 +102,25 @@ class wf_2D_view : public wf_view_transformer_t
         virtual wf_point local_to_transformed_point(wf_geometry view, wf_point point);
         virtual wf_point transformed_to_local_point(wf_geometry view, wf_point point);
 
+        virtual bool is_damage_preserving();
+
+        /* Renders all damaged rectangles in a single batch */
+        virtual void render_with_damage(uint32_t src_tex, wlr_box src_box,
+            const wf_region& damage, const wf_framebuffer& target_fb);
+
         virtual void render_box(uint32_t src_tex, wlr_box src_box,
             wlr_box scissor_box, const wf_framebuffer& target_fb);
+
+    private:
+        void get_render_quad(wlr_box src_box, const wf_framebuffer& fb,
+            gl_geometry& geometry, glm::mat4& transform);
+
+        /* The parameters at the last call of is_damage_preserving() */
+        struct
+        {
+            float angle, scale_x, scale_y;
+            float translation_x, translation_y, alpha;
+        } last_state = {NAN, NAN, NAN, NAN, NAN, NAN};
 };
 
 /* Those are centered relative to the view's bounding box */
@@ -111,10 +143,24 @@ class wf_3D_view : public wf_view_transformer_t
         virtual wf_point local_to_transformed_point(wf_geometry view, wf_point point);
         virtual wf_point transformed_to_local_point(wf_geometry view, wf_point point);
 
+        virtual bool is_damage_preserving();
+
+        /* Renders all damaged rectangles in a single batch */
+        virtual void render_with_damage(uint32_t src_tex, wlr_box src_box,
+            const wf_region& damage, const wf_framebuffer& target_fb);
+
         virtual void render_box(uint32_t src_tex, wlr_box src_box,
             wlr_box scissor_box, const wf_framebuffer& target_fb);
 
         static const float fov; // PI / 8
+
+    private:
+        void get_render_quad(wlr_box src_box, const wf_framebuffer& fb,
+            gl_geometry& geometry, glm::mat4& transform);
+
+        /* The transform and color at the last call of is_damage_preserving() */
+        glm::mat4 last_transform{0.0};
+        glm::vec4 last_color{-1};
         static glm::mat4 default_view_matrix();
         static glm::mat4 default_proj_matrix();
 };
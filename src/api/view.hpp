@@ -193,7 +193,14 @@ class wayfire_view_t : public wayfire_surface_t, public wf_object_base
 
         struct offscreen_buffer_t : public wf_framebuffer
         {
+            /* Damage since the last snapshot, relative to the untransformed
+             * bounding box of the view */
             wf_region cached_damage;
+            /* Position of the main surface relative to the snapshot */
+            wf_point main_offset = {0, 0};
+            /* Parts of the snapshot which were repainted since the transformers
+             * last used it, relative to the snapshot in output coordinates */
+            wf_region changed_region;
             bool valid();
         } offscreen_buffer;
 
@@ -205,6 +212,8 @@ class wayfire_view_t : public wayfire_surface_t, public wf_object_base
             std::string plugin_name = "";
             std::unique_ptr<wf_view_transformer_t> transform;
             wf_framebuffer fb;
+            /* The box of the transformer's input when it was last rendered */
+            wf_geometry input_box = {0, 0, 0, 0};
 
             transform_t();
             ~transform_t();
@@ -56,6 +56,13 @@ class workspace_manager
          * the workspace. See view.hpp for a distinction between wm, output and boundingbox geometry */
         virtual std::vector<wayfire_view>
             get_views_on_workspace(std::tuple<int, int> ws, uint32_t layer_mask, bool wm_only) = 0;
+
+        /* returns the views in the given layers whose bounding box contains the
+         * given point, from the topmost to the bottommost. The point is in
+         * output-local coordinates. Only the bounding boxes are checked, so
+         * the point isn't necessarily inside the input region of the views */
+        virtual std::vector<wayfire_view>
+            get_views_at(wf_point point, uint32_t layer_mask) = 0;
         virtual void for_each_view(view_callback_proc_t call, uint32_t layers_mask) = 0;
         virtual void for_each_view_reverse(view_callback_proc_t call, uint32_t layers_mask) = 0;
 
@@ -87,6 +87,9 @@ void wayfire_core::init(wayfire_config *conf)
     configure(conf);
     wf_input_device_internal::config.load(conf);
 
+    int workers = *conf->get_section("core")->get_option("worker_threads", "0");
+    thread_pool = std::make_unique<wf::thread_pool_t> (ev_loop, workers);
+
     protocols.data_device = wlr_data_device_manager_create(display);
     protocols.data_control = wlr_data_control_manager_v1_create(display);
     wlr_renderer_init_wl_display(renderer, display);
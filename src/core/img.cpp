@@ -1,6 +1,8 @@
 #include "img.hpp"
 #include "opengl.hpp"
 #include "debug.hpp"
+#include "core.hpp"
+#include <nonstd/safe-list.hpp>
 
 #ifdef BUILD_WITH_IMAGEIO
 #include <png.h>
@@ -10,6 +12,8 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <setjmp.h>
+#include <sys/stat.h>
 #include <cstdio>
 #include <iostream>
 #include <unordered_map>
@@ -18,7 +22,8 @@
 #define TEXTURE_LOAD_ERROR 0
 
 namespace image_io {
-    using Loader = std::function<bool(const char *, GLuint)>;
+    /* Loaders only decode the image, so they can run on any thread */
+    using Loader = std::function<bool(const char *, decoded_image_t&)>;
     using Writer = std::function<void(const char *name, uint8_t *pixels, unsigned long, unsigned long)>;
     namespace {
         std::unordered_map<std::string, Loader> loaders;
@@ -28,24 +33,29 @@ namespace image_io {
 #ifdef BUILD_WITH_IMAGEIO
     /* All backend functions are taken from the internet.
      * If you want to be credited, contact me */
-    bool texture_from_png(const char *filename, GLuint target)
+    bool texture_from_png(const char *filename, decoded_image_t& image)
     {
         FILE *fp = fopen(filename, "rb");
+        if (!fp)
+        {
+            log_error("failed to read PNG file %s", filename);
+            return false;
+        }
+
         int width, height;
         png_byte color_type;
         png_byte bit_depth;
-        png_bytep *row_pointers;
+        std::vector<png_bytep> row_pointers;
 
         png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-        if(!png)
-            return false;
-
-        png_infop infos = png_create_info_struct(png);
-        if(!infos)
-            return false;
-
-        if(setjmp(png_jmpbuf(png)))
+        png_infop infos = png ? png_create_info_struct(png) : NULL;
+        if (!png || !infos || setjmp(png_jmpbuf(png)))
+        {
+            log_error("failed to decode PNG file %s", filename);
+            png_destroy_read_struct(&png, &infos, NULL);
+            fclose(fp);
             return false;
+        }
 
         png_init_io(png, fp);
         png_read_info(png, infos);
@@ -80,23 +90,19 @@ namespace image_io {
 
         png_read_update_info(png, infos);
 
-        row_pointers = new png_bytep[height];
-        png_byte *data = new png_byte[height * png_get_rowbytes(png, infos)];
-
+        size_t row_bytes = png_get_rowbytes(png, infos);
+        image.pixels.resize(height * row_bytes);
+        row_pointers.resize(height);
         for(int i = 0; i < height; i++)
-        {
-            row_pointers[i] = data + i * png_get_rowbytes(png, infos);
-        }
-
-        png_read_image(png, row_pointers);
-        GL_CALL(glTexImage2D(target, 0, GL_RGBA, width, height, 0,
-                             GL_RGBA, GL_UNSIGNED_BYTE, (GLvoid *) data));
+            row_pointers[i] = image.pixels.data() + i * row_bytes;
 
+        png_read_image(png, row_pointers.data());
         png_destroy_read_struct(&png, &infos, NULL);
-        delete[] row_pointers;
-        delete[] data;
-
         fclose(fp);
+
+        image.width = width;
+        image.height = height;
+        image.format = GL_RGBA;
         return true;
     }
 
@@ -144,74 +150,264 @@ namespace image_io {
         delete[] rows;
     }
 
-    bool texture_from_jpeg(const char *FileName, GLuint target)
+    struct jpeg_error_handler_t
+    {
+        struct jpeg_error_mgr mgr;
+        jmp_buf jump;
+    };
+
+    /* The default handler calls exit() */
+    void jpeg_error_exit(j_common_ptr info)
+    {
+        char message[JMSG_LENGTH_MAX];
+        info->err->format_message(info, message);
+        log_error("failed to decode JPEG file: %s", message);
+
+        longjmp(reinterpret_cast<jpeg_error_handler_t*> (info->err)->jump, 1);
+    }
+
+    bool texture_from_jpeg(const char *FileName, decoded_image_t& image)
     {
-        unsigned long data_size;
         unsigned char *rowptr[1];
-        unsigned char *jdata;
         struct jpeg_decompress_struct infot;
-        struct jpeg_error_mgr err;
+        jpeg_error_handler_t err;
 
         std::FILE *file = fopen(FileName, "rb");
-        infot.err = jpeg_std_error(& err);
-        jpeg_create_decompress(&infot);
-
         if(!file)
         {
             log_error("failed to read JPEG file %s", FileName);
             return false;
         }
 
+        infot.err = jpeg_std_error(&err.mgr);
+        err.mgr.error_exit = jpeg_error_exit;
+        if (setjmp(err.jump))
+        {
+            jpeg_destroy_decompress(&infot);
+            fclose(file);
+            return false;
+        }
+
+        jpeg_create_decompress(&infot);
         jpeg_stdio_src(&infot, file);
         jpeg_read_header(&infot, TRUE);
+        infot.out_color_space = JCS_RGB;
         jpeg_start_decompress(&infot);
 
-        data_size = infot.output_width * infot.output_height * 3;
-
-        jdata = new unsigned char[data_size];
+        size_t row_bytes = 3 * infot.output_width;
+        image.pixels.resize(row_bytes * infot.output_height);
         while (infot.output_scanline < infot.output_height) {
-            rowptr[0] = (unsigned char *)jdata +  3* infot.output_width * infot.output_scanline;
+            rowptr[0] = image.pixels.data() + row_bytes * infot.output_scanline;
             jpeg_read_scanlines(&infot, rowptr, 1);
         }
 
-        jpeg_finish_decompress(&infot);
-
-        GL_CALL(glTexImage2D(target, 0, GL_RGB,
-                infot.output_width, infot.output_height,
-                0, GL_RGB, GL_UNSIGNED_BYTE, jdata));
+        image.width = infot.output_width;
+        image.height = infot.output_height;
+        image.format = GL_RGB;
 
+        jpeg_finish_decompress(&infot);
+        jpeg_destroy_decompress(&infot);
         fclose(file);
-        delete[] jdata;
 
         return true;
     }
 #endif
 
-    bool load_from_file(std::string name, GLuint target)
+    namespace
     {
-        if (access(name.c_str(), F_OK) == -1) {
-            if (!name.empty())
-                log_error("%s() cannot access \"%s\"", __func__, name.c_str());
-            return false;
+        const Loader *find_loader(const std::string& name)
+        {
+            if (access(name.c_str(), F_OK) == -1) {
+                if (!name.empty())
+                    log_error("cannot access image \"%s\"", name.c_str());
+                return nullptr;
+            }
+
+            int len = name.length();
+            if (len < 4 || name[len - 4] != '.') {
+                log_error("cannot load image without extension or with invalid extension!");
+                return nullptr;
+            }
+
+            auto ext = name.substr(len - 3, 3);
+            for (int i = 0; i < 3; i++)
+                ext[i] = std::tolower(ext[i]);
+
+            auto it = loaders.find(ext);
+            if (it == loaders.end()) {
+                log_error("cannot load image with unsupported extension %s", ext.c_str());
+                return nullptr;
+            }
+
+            return &it->second;
         }
 
-        int len = name.length();
-        if (len < 4 || name[len - 4] != '.') {
-            log_error("load_from_file() called with file without extension or with invalid extension!");
-            return false;
+        /* Requires bound GL context and texture */
+        void upload_image(const decoded_image_t& image, GLuint target)
+        {
+            /* RGB rows aren't necessarily aligned to 4 bytes */
+            GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+            GL_CALL(glTexImage2D(target, 0, image.format, image.width, image.height,
+                    0, image.format, GL_UNSIGNED_BYTE, image.pixels.data()));
+            GL_CALL(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+        }
+    }
+
+    struct image_future_t::state_t
+    {
+        /* Written by the worker, read only after ready is set */
+        decoded_image_t image;
+        bool decoded = false;
+
+        /* Accessed only on the main thread */
+        bool ready = false;
+        wf::safe_list_t<image_callback_t*> callbacks;
+    };
+
+    namespace
+    {
+        /* Images which are being decoded or still have users, keyed by the
+         * file and its modification time and size, so that a changed file is
+         * decoded again */
+        std::unordered_map<std::string,
+            std::weak_ptr<image_future_t::state_t>> image_cache;
+
+        std::string get_cache_key(const std::string& name)
+        {
+            struct stat st;
+            if (stat(name.c_str(), &st) < 0)
+                return "";
+
+            return name + ":" + std::to_string(st.st_mtim.tv_sec) + "." +
+                std::to_string(st.st_mtim.tv_nsec) + ":" + std::to_string(st.st_size);
+        }
+
+        /* Returns a cached image which has finished decoding, if any */
+        std::shared_ptr<image_future_t::state_t> find_decoded(const std::string& name)
+        {
+            auto it = image_cache.find(get_cache_key(name));
+            if (it == image_cache.end())
+                return nullptr;
+
+            auto state = it->second.lock();
+            return (state && state->ready && state->decoded) ? state : nullptr;
         }
+    }
 
-        auto ext = name.substr(len - 3, 3);
-        for (int i = 0; i < 3; i++)
-            ext[i] = std::tolower(ext[i]);
+    bool image_future_t::valid() const
+    {
+        return state != nullptr;
+    }
+
+    bool image_future_t::ready() const
+    {
+        return state && state->ready;
+    }
+
+    bool image_future_t::succeeded() const
+    {
+        return ready() && state->decoded;
+    }
+
+    const decoded_image_t& image_future_t::get() const
+    {
+        return state->image;
+    }
 
-        auto it = loaders.find(ext);
-        if (it == loaders.end()) {
-            log_error("load_from_file() called with unsupported extension %s", ext.c_str());
+    bool image_future_t::upload(GLuint target) const
+    {
+        if (!succeeded())
             return false;
-        } else {
-            return it->second(name.c_str(), target);
+
+        upload_image(state->image, target);
+        return true;
+    }
+
+    void image_future_t::add_ready_callback(image_callback_t *callback) const
+    {
+        if (!state)
+            return;
+
+        if (state->ready)
+            return (*callback) ();
+
+        state->callbacks.push_back(callback);
+    }
+
+    void image_future_t::rem_ready_callback(image_callback_t *callback) const
+    {
+        if (state)
+            state->callbacks.remove_all(callback);
+    }
+
+    image_future_t load_async(std::string name)
+    {
+        image_future_t future;
+
+        auto key = get_cache_key(name);
+        auto it = image_cache.find(key);
+        if (it != image_cache.end())
+        {
+            future.state = it->second.lock();
+            if (future.state)
+                return future;
+        }
+
+        /* Drop the entries of images which nobody uses anymore */
+        for (auto it = image_cache.begin(); it != image_cache.end();)
+        {
+            if (it->second.expired())
+                it = image_cache.erase(it);
+            else
+                ++it;
+        }
+
+        auto state = std::make_shared<image_future_t::state_t> ();
+        future.state = state;
+
+        auto loader = find_loader(name);
+        if (!loader)
+        {
+            state->ready = true;
+            return future;
+        }
+
+        image_cache[key] = state;
+        core->thread_pool->run_async([=] ()
+        {
+            state->decoded = (*loader) (name.c_str(), state->image);
+        }, [=] ()
+        {
+            state->ready = true;
+            state->callbacks.for_each([] (image_callback_t *callback) {
+                (*callback) ();
+            });
+            state->callbacks.remove_if([] (image_callback_t*) { return true; });
+        });
+
+        return future;
+    }
+
+    bool load_from_file(std::string name, GLuint target)
+    {
+        /* Reuse the pixels if another user has loaded the same image */
+        auto cached = find_decoded(name);
+        if (cached)
+        {
+            upload_image(cached->image, target);
+            return true;
         }
+
+        auto loader = find_loader(name);
+        if (!loader)
+            return false;
+
+        decoded_image_t image;
+        if (!(*loader) (name.c_str(), image))
+            return false;
+
+        upload_image(image, target);
+        return true;
     }
 
     void write_to_file(std::string name, uint8_t *pixels, int w, int h, std::string type)
@@ -0,0 +1,53 @@
+#include "object.hpp"
+
+namespace
+{
+/* All interned signal names. Signals are only used from the main thread. */
+struct signal_registry_t
+{
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+};
+
+signal_registry_t& get_signal_registry()
+{
+    static signal_registry_t registry;
+    return registry;
+}
+}
+
+wf_signal_id::wf_signal_id(const std::string& name)
+{
+    auto& registry = get_signal_registry();
+    auto it = registry.ids.find(name);
+    if (it != registry.ids.end())
+    {
+        index = it->second;
+    } else
+    {
+        index = registry.names.size();
+        registry.ids[name] = index;
+        registry.names.push_back(name);
+    }
+}
+
+wf_signal_id wf_signal_id::find(const std::string& name)
+{
+    auto& registry = get_signal_registry();
+
+    wf_signal_id id;
+    auto it = registry.ids.find(name);
+    if (it != registry.ids.end())
+        id.index = it->second;
+
+    return id;
+}
+
+const std::string& wf_signal_id::get_name() const
+{
+    static const std::string invalid_name = "";
+    if (!valid())
+        return invalid_name;
+
+    return get_signal_registry().names[index];
+}
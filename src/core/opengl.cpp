@@ -1,4 +1,13 @@
 #include <fstream>
+#include <list>
+#include <algorithm>
+#include <cstddef>
+#include <cmath>
+#include <chrono>
+#include <cerrno>
+#include <unordered_map>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "opengl.hpp"
 #include "debug.hpp"
 #include "output.hpp"
@@ -43,6 +52,53 @@ namespace OpenGL
         GLuint position, uvPosition;
     } program;
 
+    /* Program and vertex buffer used by wf_texture_batch. Vertices are
+     * already transformed, and carry their own color */
+    struct
+    {
+        GLuint id, vbo;
+
+        GLuint position, uvPosition, color, ignoreAlpha;
+    } batch_program;
+
+    static const char *batch_vertex_source =
+R"(#version 100
+
+attribute highp vec4 position;
+attribute highp vec2 uvPosition;
+attribute mediump vec4 color;
+attribute mediump float ignoreAlpha;
+
+varying highp vec2 uvpos;
+varying mediump vec4 vcolor;
+varying mediump float vignore_alpha;
+
+void main() {
+    gl_Position = position;
+    uvpos = uvPosition;
+    vcolor = color;
+    vignore_alpha = ignoreAlpha;
+})";
+
+    static const char *batch_frag_source =
+R"(#version 100
+
+varying highp vec2 uvpos;
+varying mediump vec4 vcolor;
+varying mediump float vignore_alpha;
+
+uniform sampler2D smp;
+
+void main()
+{
+    mediump vec4 tex_color = texture2D(smp, uvpos);
+    if (vignore_alpha > 0.5)
+        tex_color.a = 1.0;
+
+    tex_color.rgb = tex_color.rgb * vcolor.a;
+    gl_FragColor = tex_color * vcolor;
+})";
+
     GLuint compile_shader_from_file(std::string path, std::string source, GLuint type)
     {
         GLuint shader = GL_CALL(glCreateShader(type));
@@ -71,55 +127,601 @@ namespace OpenGL
         return compile_shader_from_file("internal", source, type);
     }
 
-    GLuint load_shader(std::string path, GLuint type)
+    std::string read_shader_source(std::string path)
     {
         std::fstream file(path, std::ios::in);
         if(!file.is_open())
         {
             log_error("cannot open shader file %s", path.c_str());
-            return -1;
+            return "";
         }
 
         std::string str, line;
         while(std::getline(file, line))
             str += line, str += '\n';
 
-        return compile_shader(str.c_str(), type);
+        return str;
     }
 
-    GLuint create_program_from_shaders(GLuint vertex_shader,
-        GLuint fragment_shader)
+    GLuint load_shader(std::string path, GLuint type)
+    {
+        auto source = read_shader_source(path);
+        if (source.empty())
+            return -1;
+
+        return compile_shader_from_file(path, source, type);
+    }
+
+    namespace
     {
-        auto result_program = GL_CALL(glCreateProgram());
-        GL_CALL(glAttachShader(result_program, vertex_shader));
-        GL_CALL(glAttachShader(result_program, fragment_shader));
-        GL_CALL(glLinkProgram(result_program));
+        int64_t get_time_us()
+        {
+            using namespace std::chrono;
+            return duration_cast<microseconds> (
+                steady_clock::now().time_since_epoch()).count();
+        }
+
+        /* Linked programs, keyed by their shader sources, so that plugins
+         * and outputs which use the same shaders share the program.
+         *
+         * If the driver supports program binaries, they are also stored in
+         * $XDG_CACHE_HOME/wayfire/shaders and loaded instead of compiling the
+         * sources on the next start. */
+        class program_cache_t
+        {
+            struct entry_t
+            {
+                GLuint program;
+                int refcount;
+            };
+
+            /* The key is the serialized list of stages, see get_key() */
+            std::unordered_map<std::string, entry_t> programs;
+            std::unordered_map<GLuint, std::string> program_keys;
+
+            /* Keys of programs without users, the most recently released
+             * first. They are kept because plugins often recreate the same
+             * program, e.g when an option changes */
+            std::list<std::string> unused;
+            static constexpr size_t max_unused = 32;
+
+            /* Set between init() and clear() */
+            bool active = false;
+
+            /* Description of the GL implementation, binaries from other
+             * drivers are not compatible */
+            std::string driver;
+            std::string binary_dir;
+            std::vector<GLint> binary_formats;
+
+            /* Binaries are named after the hash of the driver and the key.
+             * The header is followed by the driver and the key themselves,
+             * which are compared on load, and then by the binary */
+            struct binary_header_t
+            {
+                uint32_t magic;
+                uint32_t format;
+                uint32_t driver_length;
+                uint32_t key_length;
+                /* How long the compilation took, to report the saved time */
+                int64_t compile_time;
+                uint32_t length;
+            };
+            static constexpr uint32_t binary_magic = 0x57465032; // WFP2
+
+            struct
+            {
+                int compiled = 0, loaded = 0, reused = 0;
+                int64_t compile_time = 0, load_time = 0, saved_time = 0;
+            } stats;
+
+            std::string get_binary_path(const std::string& key)
+            {
+                size_t hash = std::hash<std::string>{} (driver + key);
+
+                char name[32];
+                snprintf(name, sizeof(name), "/%016zx.bin", hash);
+                return binary_dir + name;
+            }
+
+            static bool read_string(std::ifstream& file, size_t length,
+                std::string& str)
+            {
+                str.resize(length);
+                return length == 0 || file.read(&str[0], length);
+            }
+
+            static bool create_directories(const std::string& path)
+            {
+                for (size_t i = 1; i <= path.size(); i++)
+                {
+                    if (i < path.size() && path[i] != '/')
+                        continue;
+
+                    auto dir = path.substr(0, i);
+                    if (mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+                        return false;
+                }
+
+                return true;
+            }
+
+            GLuint load_binary(const std::string& key)
+            {
+                if (binary_dir.empty())
+                    return 0;
+
+                auto path = get_binary_path(key);
+                std::ifstream file(path, std::ios::binary);
+                binary_header_t header;
+                if (!file.read((char*)&header, sizeof(header)) ||
+                    header.magic != binary_magic ||
+                    header.driver_length != driver.size() ||
+                    header.key_length != key.size())
+                {
+                    return 0;
+                }
+
+                /* Different sources or drivers with the same hash */
+                std::string file_driver, file_key;
+                if (!read_string(file, header.driver_length, file_driver) ||
+                    !read_string(file, header.key_length, file_key) ||
+                    file_driver != driver || file_key != key)
+                {
+                    return 0;
+                }
+
+                if (std::find(binary_formats.begin(), binary_formats.end(),
+                        (GLint)header.format) == binary_formats.end())
+                {
+                    return 0;
+                }
+
+                std::vector<char> binary(header.length);
+                if (!file.read(binary.data(), binary.size()))
+                    return 0;
+
+                int64_t start = get_time_us();
+                GLuint program = GL_CALL(glCreateProgram());
+                GL_CALL(glProgramBinary(program, header.format,
+                        binary.data(), binary.size()));
+
+                GLint status;
+                GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+                if (status != GL_TRUE)
+                {
+                    /* For example after a driver update */
+                    log_debug("program binary %s was rejected", path.c_str());
+                    GL_CALL(glDeleteProgram(program));
+                    return 0;
+                }
+
+                int64_t elapsed = get_time_us() - start;
+                ++stats.loaded;
+                stats.load_time += elapsed;
+                stats.saved_time += std::max(header.compile_time - elapsed, (int64_t)0);
+
+                log_debug("loaded program binary %s in %.2fms (compiling took %.2fms)",
+                    path.c_str(), elapsed / 1000.0, header.compile_time / 1000.0);
+                return program;
+            }
+
+            void store_binary(const std::string& key, GLuint program,
+                int64_t compile_time)
+            {
+                if (binary_dir.empty())
+                    return;
+
+                GLint length = 0;
+                GL_CALL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+                if (length <= 0)
+                    return;
+
+                std::vector<char> binary(length);
+                GLenum format;
+                GL_CALL(glGetProgramBinary(program, length, &length, &format,
+                        binary.data()));
+
+                binary_header_t header;
+                header.magic = binary_magic;
+                header.format = format;
+                header.driver_length = driver.size();
+                header.key_length = key.size();
+                header.compile_time = compile_time;
+                header.length = length;
+
+                /* Write to a temporary file first, so that a concurrently
+                 * starting instance never reads a partial binary */
+                auto path = get_binary_path(key);
+                auto tmp_path = path + "." + std::to_string(getpid());
+                {
+                    std::ofstream file(tmp_path, std::ios::binary);
+                    file.write((char*)&header, sizeof(header));
+                    file.write(driver.data(), driver.size());
+                    file.write(key.data(), key.size());
+                    file.write(binary.data(), length);
+                    if (!file)
+                    {
+                        log_error("failed to write program binary %s", tmp_path.c_str());
+                        unlink(tmp_path.c_str());
+                        return;
+                    }
+                }
+
+                rename(tmp_path.c_str(), path.c_str());
+            }
+
+            GLuint compile(const std::string& key,
+                const std::vector<shader_stage_t>& stages)
+            {
+                int64_t start = get_time_us();
+
+                auto program = GL_CALL(glCreateProgram());
+                std::vector<GLuint> shaders;
+                bool compiled = true;
+                for (auto& stage : stages)
+                {
+                    GLuint shader = compile_shader(stage.second, stage.first);
+                    if (shader == (GLuint)-1)
+                    {
+                        compiled = false;
+                        break;
+                    }
+
+                    shaders.push_back(shader);
+                    GL_CALL(glAttachShader(program, shader));
+                }
+
+                if (!compiled)
+                {
+                    for (auto shader : shaders)
+                    {
+                        GL_CALL(glDeleteShader(shader));
+                    }
+
+                    GL_CALL(glDeleteProgram(program));
+                    return 0;
+                }
+
+                if (!binary_dir.empty())
+                {
+                    GL_CALL(glProgramParameteri(program,
+                            GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+                }
+
+                GL_CALL(glLinkProgram(program));
+
+                /* won't be really deleted until program is deleted as well */
+                for (auto shader : shaders)
+                {
+                    GL_CALL(glDeleteShader(shader));
+                }
+
+                GLint status;
+                GL_CALL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+
+                int64_t elapsed = get_time_us() - start;
+                ++stats.compiled;
+                stats.compile_time += elapsed;
+                log_debug("compiled program in %.2fms", elapsed / 1000.0);
+
+                if (status != GL_TRUE)
+                {
+                    char log[1024];
+                    GL_CALL(glGetProgramInfoLog(program, sizeof(log), NULL, log));
+                    log_error("Failed to link program; Errors:\n%s", log);
+
+                    /* Failed programs aren't cached, so fixing a shader file
+                     * and recreating the program works */
+                    GL_CALL(glDeleteProgram(program));
+                    return 0;
+                }
+
+                store_binary(key, program, elapsed);
+                return program;
+            }
+
+            /* Each stage is stored as its type, the length of its source and
+             * the source, so different lists of stages never have equal keys */
+            std::string get_key(const std::vector<shader_stage_t>& stages)
+            {
+                std::string key;
+                for (auto& stage : stages)
+                {
+                    key += std::to_string(stage.first) + ":" +
+                        std::to_string(stage.second.size()) + ":";
+                    key += stage.second;
+                }
+
+                return key;
+            }
+
+            public:
+            /* Requires a bound GL context */
+            void init(bool use_binaries)
+            {
+                active = true;
+
+                driver.clear();
+                for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+                {
+                    auto str = GL_CALL(glGetString(name));
+                    driver += str ? (const char*)str : "";
+                    driver += '\n';
+                }
+
+                GLint num_formats = 0;
+                GL_CALL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats));
+                if (!use_binaries || num_formats <= 0)
+                    return;
+
+                binary_formats.resize(num_formats);
+                GL_CALL(glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, binary_formats.data()));
+
+                const char *xdg_cache = getenv("XDG_CACHE_HOME");
+                std::string cache_home = xdg_cache ? xdg_cache :
+                    std::string(nonull(getenv("HOME"))) + "/.cache";
+
+                binary_dir = cache_home + "/wayfire/shaders";
+                if (!create_directories(binary_dir))
+                {
+                    log_error("cannot create shader cache directory %s",
+                        binary_dir.c_str());
+                    binary_dir.clear();
+                }
+            }
+
+            /* Returns a new program, which isn't shared with other users */
+            GLuint create(const std::vector<shader_stage_t>& stages)
+            {
+                auto key = get_key(stages);
+                GLuint program = load_binary(key);
+                if (!program)
+                    program = compile(key, stages);
+
+                return program;
+            }
+
+            GLuint acquire(const std::vector<shader_stage_t>& stages)
+            {
+                auto key = get_key(stages);
+                auto it = programs.find(key);
+                if (it != programs.end())
+                {
+                    if (it->second.refcount++ == 0)
+                        unused.remove(key);
+
+                    ++stats.reused;
+                    return it->second.program;
+                }
+
+                GLuint program = load_binary(key);
+                if (!program)
+                    program = compile(key, stages);
+                if (!program)
+                    return 0;
+
+                programs[key] = {program, 1};
+                program_keys[program] = key;
+                return program;
+            }
+
+            void release(GLuint program)
+            {
+                auto it = program_keys.find(program);
+                if (it == program_keys.end())
+                {
+                    /* Not created by the cache. After clear(), the cache has
+                     * already deleted all of its programs, and the id may
+                     * have been reused since */
+                    if (active)
+                    {
+                        GL_CALL(glDeleteProgram(program));
+                    }
+
+                    return;
+                }
+
+                auto& entry = programs[it->second];
+                if (--entry.refcount > 0)
+                    return;
+
+                unused.push_front(it->second);
+                while (unused.size() > max_unused)
+                {
+                    auto key = unused.back();
+                    GL_CALL(glDeleteProgram(programs[key].program));
+                    program_keys.erase(programs[key].program);
+                    programs.erase(key);
+                    unused.pop_back();
+                }
+            }
+
+            void clear()
+            {
+                log_info("program cache: compiled %d programs in %.2fms, "
+                    "loaded %d binaries in %.2fms (saved %.2fms), %d reused",
+                    stats.compiled, stats.compile_time / 1000.0,
+                    stats.loaded, stats.load_time / 1000.0,
+                    stats.saved_time / 1000.0, stats.reused);
+
+                for (auto& entry : programs)
+                {
+                    GL_CALL(glDeleteProgram(entry.second.program));
+                }
+
+                programs.clear();
+                program_keys.clear();
+                unused.clear();
+                active = false;
+            }
+        } program_cache;
+    }
+
+    GLuint create_program_from_stages(const std::vector<shader_stage_t>& stages)
+    {
+        return program_cache.create(stages);
+    }
 
-        /* won't be really deleted until program is deleted as well */
-        GL_CALL(glDeleteShader(vertex_shader));
-        GL_CALL(glDeleteShader(fragment_shader));
+    GLuint create_shared_program_from_stages(
+        const std::vector<shader_stage_t>& stages)
+    {
+        return program_cache.acquire(stages);
+    }
 
-        return result_program;
+    void destroy_program(GLuint program)
+    {
+        program_cache.release(program);
     }
 
     GLuint create_program_from_source(std::string vertex_source,
         std::string frag_source)
     {
-        return create_program_from_shaders(
-            compile_shader(vertex_source, GL_VERTEX_SHADER),
-            compile_shader(frag_source, GL_FRAGMENT_SHADER));
+        return create_program_from_stages({
+            {GL_VERTEX_SHADER, vertex_source},
+            {GL_FRAGMENT_SHADER, frag_source}});
     }
 
     GLuint create_program(std::string vertex_path, std::string frag_path)
     {
-        return create_program_from_shaders(
-            load_shader(vertex_path, GL_VERTEX_SHADER),
-            load_shader(frag_path, GL_FRAGMENT_SHADER));
+        return create_program_from_stages({
+            {GL_VERTEX_SHADER, read_shader_source(vertex_path)},
+            {GL_FRAGMENT_SHADER, read_shader_source(frag_path)}});
+    }
+
+    GLuint create_shared_program_from_source(std::string vertex_source,
+        std::string frag_source)
+    {
+        return create_shared_program_from_stages({
+            {GL_VERTEX_SHADER, vertex_source},
+            {GL_FRAGMENT_SHADER, frag_source}});
+    }
+
+    GLuint create_shared_program(std::string vertex_path, std::string frag_path)
+    {
+        return create_shared_program_from_stages({
+            {GL_VERTEX_SHADER, read_shader_source(vertex_path)},
+            {GL_FRAGMENT_SHADER, read_shader_source(frag_path)}});
+    }
+
+    namespace
+    {
+        /* Unused textures and framebuffers, kept so that they can be reused
+         * by the next allocation with the same size. All outputs share the
+         * same GL context, so the pool is shared between them too. */
+        class framebuffer_pool_t
+        {
+            struct entry_t
+            {
+                GLuint fb, tex;
+                int32_t width, height;
+            };
+
+            /* The most recently released first */
+            std::list<entry_t> free_buffers;
+            wf_framebuffer_pool_stats stats;
+
+            static size_t get_size(int32_t width, int32_t height)
+            {
+                return 4ul * width * height;
+            }
+
+            void destroy(const entry_t& entry)
+            {
+                GL_CALL(glDeleteFramebuffers(1, &entry.fb));
+                GL_CALL(glDeleteTextures(1, &entry.tex));
+            }
+
+            /* Evict the least recently used buffers until under the limit */
+            void trim()
+            {
+                stats.max_bytes = (size_t)std::max(max_size->as_cached_int(), 0) << 20;
+                while (stats.pooled_bytes > stats.max_bytes)
+                {
+                    auto& entry = free_buffers.back();
+                    stats.pooled_bytes -= get_size(entry.width, entry.height);
+                    --stats.pooled_buffers;
+                    ++stats.evictions;
+
+                    destroy(entry);
+                    free_buffers.pop_back();
+                }
+            }
+
+            public:
+            /* Pool size in MiB */
+            wf_option max_size;
+
+            bool acquire(int32_t width, int32_t height, GLuint& fb, GLuint& tex)
+            {
+                auto it = std::find_if(free_buffers.begin(), free_buffers.end(),
+                    [=] (const entry_t& entry)
+                    { return entry.width == width && entry.height == height; });
+
+                if (it == free_buffers.end())
+                {
+                    ++stats.misses;
+                    return false;
+                }
+
+                ++stats.hits;
+                stats.pooled_bytes -= get_size(width, height);
+                --stats.pooled_buffers;
+
+                fb = it->fb;
+                tex = it->tex;
+                free_buffers.erase(it);
+
+                /* The previous user might have changed the sampling */
+                GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+                GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+                GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+                GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+                GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+                GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
+
+                return true;
+            }
+
+            void release(GLuint fb, GLuint tex, int32_t width, int32_t height)
+            {
+                if (width <= 0 || height <= 0)
+                    return destroy({fb, tex, width, height});
+
+                free_buffers.push_front({fb, tex, width, height});
+                stats.pooled_bytes += get_size(width, height);
+                ++stats.pooled_buffers;
+                trim();
+            }
+
+            void clear()
+            {
+                for (auto& entry : free_buffers)
+                    destroy(entry);
+
+                free_buffers.clear();
+                stats.pooled_bytes = stats.pooled_buffers = 0;
+            }
+
+            wf_framebuffer_pool_stats get_stats()
+            {
+                return stats;
+            }
+        } framebuffer_pool;
+    }
+
+    wf_framebuffer_pool_stats get_framebuffer_pool_stats()
+    {
+        return framebuffer_pool.get_stats();
     }
 
     void init()
     {
+        auto section = core->config->get_section("core");
+        framebuffer_pool.max_size = section->get_option("framebuffer_pool_size", "128");
+
         render_begin();
+        program_cache.init(section->get_option("shader_cache", "1")->as_int());
 
         // enable_gl_synchronuous_debug()
         std::string shader_path = INSTALL_PREFIX "/share/wayfire/shaders";
@@ -131,13 +733,25 @@ namespace OpenGL
         program.position   = GL_CALL(glGetAttribLocation(program.id, "position"));
         program.uvPosition = GL_CALL(glGetAttribLocation(program.id, "uvPosition"));
 
+        auto& bp = batch_program;
+        bp.id = create_program_from_source(batch_vertex_source, batch_frag_source);
+        bp.position    = GL_CALL(glGetAttribLocation(bp.id, "position"));
+        bp.uvPosition  = GL_CALL(glGetAttribLocation(bp.id, "uvPosition"));
+        bp.color       = GL_CALL(glGetAttribLocation(bp.id, "color"));
+        bp.ignoreAlpha = GL_CALL(glGetAttribLocation(bp.id, "ignoreAlpha"));
+        GL_CALL(glGenBuffers(1, &bp.vbo));
+
         render_end();
     }
 
     void fini()
     {
         render_begin();
-        GL_CALL(glDeleteProgram(program.id));
+        framebuffer_pool.clear();
+        GL_CALL(glDeleteBuffers(1, &batch_program.vbo));
+        destroy_program(batch_program.id);
+        destroy_program(program.id);
+        program_cache.clear();
         render_end();
     }
 
@@ -243,71 +857,248 @@ namespace OpenGL
     }
 }
 
-bool wf_framebuffer_base::allocate(int width, int height)
+wf_texture_batch::wf_texture_batch(const wf_framebuffer_base& target)
+{
+    viewport_width = target.viewport_width;
+    viewport_height = target.viewport_height;
+}
+
+wf_texture_batch::~wf_texture_batch()
 {
-    bool first_allocate = false;
-    if (fb == (uint32_t)-1)
+    flush();
+}
+
+void wf_texture_batch::add_quad(GLuint tex, const gl_geometry& g,
+    const gl_geometry& texg, const glm::mat4& transform, const glm::vec4& color,
+    uint32_t bits, const wlr_box& scissor)
+{
+    if (scissor.width <= 0 || scissor.height <= 0)
+        return;
+
+    gl_geometry final_g = g;
+    if (bits & TEXTURE_TRANSFORM_INVERT_Y)
+        std::swap(final_g.y1, final_g.y2);
+    if (bits & TEXTURE_TRANSFORM_INVERT_X)
+        std::swap(final_g.x1, final_g.x2);
+
+    /* Same corners and texture coordinates as in render_transformed_texture() */
+    const glm::vec2 corners[4] = {
+        {final_g.x1, final_g.y2}, {final_g.x2, final_g.y2},
+        {final_g.x2, final_g.y1}, {final_g.x1, final_g.y1},
+    };
+    glm::vec2 uvs[4] = {
+        {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f},
+    };
+
+    if (bits & TEXTURE_USE_TEX_GEOMETRY)
     {
-        first_allocate = true;
-        GL_CALL(glGenFramebuffers(1, &fb));
+        uvs[0] = {texg.x1, texg.y2};
+        uvs[1] = {texg.x2, texg.y2};
+        uvs[2] = {texg.x2, texg.y1};
+        uvs[3] = {texg.x1, texg.y1};
     }
 
-    if (tex == (uint32_t)-1)
+    vertex_t quad[4];
+    bool affine = true;
+    for (int i = 0; i < 4; i++)
     {
+        auto pos = transform * glm::vec4(corners[i], 0.0f, 1.0f);
+        affine &= std::abs(pos.w - 1.0f) < 1e-6;
 
-        first_allocate = true;
-        GL_CALL(glGenTextures(1, &tex));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        quad[i] = {{pos.x, pos.y, pos.z, pos.w}, {uvs[i].x, uvs[i].y},
+            {color.r, color.g, color.b, color.a},
+            (bits & TEXTURE_IGNORE_ALPHA) ? 1.0f : 0.0f};
     }
 
-    bool is_resize = false;
-    /* Special case: fb = 0. This occurs in the default workspace streams, we don't resize anything */
-    if (fb != 0)
+    /* Vertices 0-1 and 2-3 share y, 1-2 and 3-0 share x */
+    auto& q = quad;
+    bool axis_aligned = affine &&
+        q[0].position[1] == q[1].position[1] && q[2].position[1] == q[3].position[1] &&
+        q[1].position[0] == q[2].position[0] && q[3].position[0] == q[0].position[0];
+
+    if (!axis_aligned)
+        return push_quad(tex, quad, false, scissor);
+
+    /* Clip the quad to the scissor box in normalized device coordinates.
+     * The scissor box has its origin in the top-left corner */
+    float sx1 = 2.0f * scissor.x / viewport_width - 1.0f;
+    float sx2 = 2.0f * (scissor.x + scissor.width) / viewport_width - 1.0f;
+    float sy1 = 1.0f - 2.0f * (scissor.y + scissor.height) / viewport_height;
+    float sy2 = 1.0f - 2.0f * scissor.y / viewport_height;
+
+    float x1 = q[0].position[0], x2 = q[1].position[0];
+    float y1 = q[0].position[1], y2 = q[3].position[1];
+
+    float cx1 = std::max(std::min(x1, x2), sx1);
+    float cx2 = std::min(std::max(x1, x2), sx2);
+    float cy1 = std::max(std::min(y1, y2), sy1);
+    float cy2 = std::min(std::max(y1, y2), sy2);
+    if (cx1 >= cx2 || cy1 >= cy2)
+        return;
+
+    for (int i = 0; i < 4; i++)
     {
-        if (first_allocate || width != viewport_width || height != viewport_height)
+        float x = (q[i].position[0] == std::min(x1, x2)) ? cx1 : cx2;
+        float y = (q[i].position[1] == std::min(y1, y2)) ? cy1 : cy2;
+
+        /* Interpolate the texture coordinates, x1 != x2 and y1 != y2 because
+         * the clipped quad is not empty */
+        float tx = (x - x1) / (x2 - x1);
+        float ty = (y - y1) / (y2 - y1);
+        q[i].uv[0] = uvs[0].x + tx * (uvs[1].x - uvs[0].x);
+        q[i].uv[1] = uvs[0].y + ty * (uvs[3].y - uvs[0].y);
+        q[i].position[0] = x;
+        q[i].position[1] = y;
+    }
+
+    push_quad(tex, quad, true, scissor);
+}
+
+void wf_texture_batch::push_quad(GLuint tex, const vertex_t quad[4],
+    bool clipped, const wlr_box& scissor)
+{
+    bool merge = !draws.empty() && draws.back().tex == tex &&
+        draws.back().clipped == clipped &&
+        (clipped || draws.back().scissor == scissor);
+
+    if (!merge)
+        draws.push_back({tex, clipped, scissor, vertices.size(), 0});
+
+    /* Two triangles per quad */
+    for (int i : {0, 1, 2, 0, 2, 3})
+        vertices.push_back(quad[i]);
+
+    draws.back().count += 6;
+}
+
+void wf_texture_batch::flush()
+{
+    if (draws.empty())
+        return;
+
+    auto& bp = OpenGL::batch_program;
+    GL_CALL(glUseProgram(bp.id));
+
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, bp.vbo));
+    GL_CALL(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vertex_t),
+            vertices.data(), GL_STREAM_DRAW));
+
+    const auto set_attrib = [] (GLuint location, int size, size_t offset)
+    {
+        GL_CALL(glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE,
+                sizeof(vertex_t), (void*)offset));
+        GL_CALL(glEnableVertexAttribArray(location));
+    };
+
+    set_attrib(bp.position, 4, offsetof(vertex_t, position));
+    set_attrib(bp.uvPosition, 2, offsetof(vertex_t, uv));
+    set_attrib(bp.color, 4, offsetof(vertex_t, color));
+    set_attrib(bp.ignoreAlpha, 1, offsetof(vertex_t, ignore_alpha));
+
+    GL_CALL(glActiveTexture(GL_TEXTURE0));
+    GL_CALL(glEnable(GL_BLEND));
+    GL_CALL(glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA));
+
+    for (auto& draw : draws)
+    {
+        if (draw.clipped)
         {
-            is_resize = true;
-            GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-            GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
-                    0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+            GL_CALL(glDisable(GL_SCISSOR_TEST));
+        } else
+        {
+            GL_CALL(glEnable(GL_SCISSOR_TEST));
+            GL_CALL(glScissor(draw.scissor.x,
+                    viewport_height - draw.scissor.y - draw.scissor.height,
+                    draw.scissor.width, draw.scissor.height));
         }
+
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, draw.tex));
+        GL_CALL(glDrawArrays(GL_TRIANGLES, draw.first, draw.count));
+    }
+
+    GL_CALL(glDisableVertexAttribArray(bp.ignoreAlpha));
+    GL_CALL(glDisableVertexAttribArray(bp.color));
+    GL_CALL(glDisableVertexAttribArray(bp.uvPosition));
+    GL_CALL(glDisableVertexAttribArray(bp.position));
+
+    /* Other code uses client-side vertex arrays */
+    GL_CALL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+    vertices.clear();
+    draws.clear();
+}
+
+bool wf_framebuffer_base::allocate(int width, int height)
+{
+    /* Special case: fb = 0. This occurs in the default workspace streams, we don't resize anything */
+    if (fb == 0)
+    {
+        viewport_width = width;
+        viewport_height = height;
+        return false;
     }
 
-    if (first_allocate)
+    bool is_allocated = (fb != (uint32_t)-1 && tex != (uint32_t)-1);
+    if (is_allocated && width == viewport_width && height == viewport_height)
+        return false;
+
+    /* If the pool has buffers with the new size, return the old ones there */
+    GLuint pooled_fb, pooled_tex;
+    if (OpenGL::framebuffer_pool.acquire(width, height, pooled_fb, pooled_tex))
     {
-        GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb));
-        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
-        GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                GL_TEXTURE_2D, tex, 0));
+        release();
+        fb = pooled_fb;
+        tex = pooled_tex;
+        viewport_width = allocated_width = width;
+        viewport_height = allocated_height = height;
+        return true;
     }
 
-    if (is_resize || first_allocate)
+    /* Otherwise, resize our own texture, so that continuous resizing doesn't
+     * fill the pool with buffers of sizes which won't be used again */
+    if (!is_allocated)
     {
-        auto status = GL_CALL(glCheckFramebufferStatus(GL_FRAMEBUFFER));
-        if (status != GL_FRAMEBUFFER_COMPLETE)
-        {
-            log_error("failed to initialize framebuffer");
-            return false;
-        }
+        release();
+        GL_CALL(glGenFramebuffers(1, &fb));
+        GL_CALL(glGenTextures(1, &tex));
+        GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+        GL_CALL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
     }
 
-    viewport_width = width;
-    viewport_height = height;
+    viewport_width = allocated_width = width;
+    viewport_height = allocated_height = height;
+
+    GL_CALL(glBindTexture(GL_TEXTURE_2D, tex));
+    GL_CALL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height,
+            0, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+
+    GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, fb));
+    GL_CALL(glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+            GL_TEXTURE_2D, tex, 0));
+
+    auto status = GL_CALL(glCheckFramebufferStatus(GL_FRAMEBUFFER));
 
     GL_CALL(glBindTexture(GL_TEXTURE_2D, 0));
     GL_CALL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
 
-    return is_resize || first_allocate;
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+        log_error("failed to initialize framebuffer");
+        return false;
+    }
+
+    return true;
 }
 
 void wf_framebuffer_base::copy_state(wf_framebuffer_base&& other)
 {
     this->viewport_width = other.viewport_width;
     this->viewport_height = other.viewport_height;
+    this->allocated_width = other.allocated_width;
+    this->allocated_height = other.allocated_height;
 
     this->fb = other.fb;
     this->tex = other.tex;
@@ -346,6 +1137,13 @@ void wf_framebuffer_base::scissor(wlr_box box) const
 
 void wf_framebuffer_base::release()
 {
+    if (fb != uint32_t(-1) && fb != 0 && tex != uint32_t(-1))
+    {
+        OpenGL::framebuffer_pool.release(fb, tex, allocated_width, allocated_height);
+        reset();
+        return;
+    }
+
     if (fb != uint32_t(-1) && fb != 0)
     {
         GL_CALL(glDeleteFramebuffers(1, &fb));
@@ -364,6 +1162,7 @@ void wf_framebuffer_base::reset()
     fb = -1;
     tex = -1;
     viewport_width = viewport_height = 0;
+    allocated_width = allocated_height = 0;
 }
 
 wlr_box wf_framebuffer::framebuffer_box_from_damage_box(wlr_box box) const
@@ -22,26 +22,23 @@ bool input_manager::handle_pointer_button(wlr_event_pointer_button *ev)
             core->focus_output(output);
         }
 
-        GetTuple(ox, oy, core->get_active_output()->get_cursor_position());
+        auto dispatch_start = std::chrono::steady_clock::now();
+        auto output = core->get_active_output();
+        GetTuple(ox, oy, output->get_cursor_position());
 
         auto mod_state = get_modifiers();
-        for (auto& binding : bindings[WF_BINDING_BUTTON])
+        for (auto binding :
+            find_bindings(button_index, output, mod_state, ev->button))
         {
-            if (binding->output == core->get_active_output() &&
-                binding->value->as_cached_button().matches(
-                    {mod_state, ev->button}))
-            {
-                /* We must be careful because the callback might be erased,
-                 * so force copy the callback into the lambda */
-                auto callback = binding->call.button;
-                callbacks.push_back([=] () {(*callback) (ev->button, ox, oy);});
-            }
+            /* We must be careful because the callback might be erased,
+             * so force copy the callback into the lambda */
+            auto callback = binding->call.button;
+            callbacks.push_back([=] () {(*callback) (ev->button, ox, oy);});
         }
 
-        for (auto& binding : bindings[WF_BINDING_ACTIVATOR])
+        for (auto binding : find_activators(output))
         {
-            if (binding->output == core->get_active_output() &&
-                binding->value->matches_button({mod_state, ev->button}))
+            if (binding->value->matches_button({mod_state, ev->button}))
             {
                 /* We must be careful because the callback might be erased,
                  * so force copy the callback into the lambda */
@@ -54,6 +51,8 @@ bool input_manager::handle_pointer_button(wlr_event_pointer_button *ev)
 
         for (auto call : callbacks)
             call();
+
+        record_binding_dispatch(dispatch_start, callbacks.size());
     }
     else
     {
@@ -157,12 +156,14 @@ void input_manager::handle_pointer_motion(wlr_event_pointer_motion *ev)
 
     wlr_cursor_move(cursor->cursor, ev->device, ev->delta_x, ev->delta_y);
     update_cursor_position(ev->time_msec);
+    core->emit_signal("pointer-motion", nullptr);
 }
 
 void input_manager::handle_pointer_motion_absolute(wlr_event_pointer_motion_absolute *ev)
 {
     wlr_cursor_warp_absolute(cursor->cursor, ev->device, ev->x, ev->y);
     update_cursor_position(ev->time_msec);
+    core->emit_signal("pointer-motion", nullptr);
 }
 
 void input_manager::handle_pointer_axis(wlr_event_pointer_axis *ev)
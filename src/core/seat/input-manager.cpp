@@ -1,5 +1,6 @@
 #include <cassert>
 #include <algorithm>
+#include <cinttypes>
 #include <libinput.h>
 
 #include <iostream>
@@ -138,6 +139,9 @@ input_manager::input_manager()
             dev->update_options();
         for (auto& kbd : keyboards)
             kbd->reload_input_options();
+
+        /* Binding options might have changed without notifying us */
+        reindex_bindings();
     };
 
     core->connect_signal("reload-config", &config_updated);
@@ -152,6 +156,12 @@ input_manager::input_manager()
 input_manager::~input_manager()
 {
     core->disconnect_signal("reload-config", &config_updated);
+
+    auto& stats = dispatch_stats;
+    log_debug("binding dispatch: %" PRIu64 " events, %" PRIu64 " bindings triggered,"
+        " average %" PRId64 "us, max %" PRId64 "us", stats.events, stats.triggered,
+        stats.total_time / (int64_t)std::max(stats.events, (uint64_t)1),
+        stats.max_time);
 }
 
 uint32_t input_manager::get_modifiers()
@@ -251,18 +261,20 @@ wayfire_surface_t* input_manager::input_surface_at(int x, int y,
     x -= og.x;
     y -= og.y;
 
-    wayfire_surface_t *new_focus = nullptr;
-    output->workspace->for_each_view(
-        [&] (wayfire_view view)
-        {
-            if (new_focus) return; // we already found a focus surface
+    /* Only the views whose bounding box contains the point can have input there */
+    auto views = output->workspace->get_views_at({x, y}, WF_VISIBLE_LAYERS);
+    for (auto& view : views)
+    {
+        // make sure focusing this surface isn't disabled
+        if (!can_focus_surface(view.get()))
+            continue;
 
-            if (can_focus_surface(view.get())) // make sure focusing this surface isn't disabled
-                new_focus = view->map_input_coordinates(x, y, lx, ly);
-        },
-        WF_VISIBLE_LAYERS);
+        auto new_focus = view->map_input_coordinates(x, y, lx, ly);
+        if (new_focus)
+            return new_focus;
+    }
 
-    return new_focus;
+    return nullptr;
 }
 
 void input_manager::set_exclusive_focus(wl_client *client)
@@ -299,6 +311,14 @@ wf_binding* input_manager::new_binding(wf_binding_type type, wf_option value,
     auto raw = binding.get();
     bindings[type].push_back(std::move(binding));
 
+    index_binding(raw);
+    raw->value_changed = [=] ()
+    {
+        unindex_binding(raw);
+        index_binding(raw);
+    };
+    value->add_updated_handler(&raw->value_changed);
+
     return raw;
 }
 
@@ -311,6 +331,8 @@ void input_manager::rem_binding(binding_criteria criteria)
         while (it != container.end())
         {
             if (criteria((*it).get())) {
+                (*it)->value->rem_updated_handler(&(*it)->value_changed);
+                unindex_binding((*it).get());
                 it = container.erase(it);
             } else {
                 ++it;
@@ -319,6 +341,133 @@ void input_manager::rem_binding(binding_criteria criteria)
     }
 }
 
+input_manager::binding_index_t *input_manager::get_binding_index(
+    wf_binding *binding, binding_index_key_t& key)
+{
+    key.output = binding->output;
+    switch (binding->type)
+    {
+        case WF_BINDING_KEY:
+        {
+            auto value = binding->value->as_cached_key();
+            key.mods = value.mod;
+            key.code = value.keyval;
+            return &key_index;
+        }
+
+        case WF_BINDING_BUTTON:
+        {
+            auto value = binding->value->as_cached_button();
+            key.mods = value.mod;
+            key.code = value.button;
+            return &button_index;
+        }
+
+        default:
+            return nullptr;
+    }
+}
+
+void input_manager::index_binding(wf_binding *binding)
+{
+    if (binding->type == WF_BINDING_ACTIVATOR)
+    {
+        activator_index[binding->output].push_back(binding);
+        return;
+    }
+
+    binding_index_key_t key;
+    auto index = get_binding_index(binding, key);
+    if (index)
+        (*index)[key].push_back(binding);
+}
+
+void input_manager::unindex_binding(wf_binding *binding)
+{
+    auto remove_from = [=] (std::vector<wf_binding*>& list)
+    {
+        list.erase(std::remove(list.begin(), list.end(), binding), list.end());
+    };
+
+    if (binding->type == WF_BINDING_ACTIVATOR)
+    {
+        auto it = activator_index.find(binding->output);
+        if (it != activator_index.end())
+        {
+            remove_from(it->second);
+            if (it->second.empty())
+                activator_index.erase(it);
+        }
+
+        return;
+    }
+
+    binding_index_key_t key;
+    auto index = get_binding_index(binding, key);
+    if (!index)
+        return;
+
+    /* The option might have changed since the binding was indexed, so we
+     * can't rely on the key it was stored under */
+    for (auto it = index->begin(); it != index->end();)
+    {
+        remove_from(it->second);
+        if (it->second.empty())
+            it = index->erase(it);
+        else
+            ++it;
+    }
+}
+
+void input_manager::reindex_bindings()
+{
+    key_index.clear();
+    button_index.clear();
+    activator_index.clear();
+
+    for (auto& category : bindings)
+    {
+        for (auto& binding : category.second)
+            index_binding(binding.get());
+    }
+}
+
+const std::vector<wf_binding*>& input_manager::find_bindings(
+    binding_index_t& index, wayfire_output *output, uint32_t mods, uint32_t code)
+{
+    static const std::vector<wf_binding*> none;
+
+    auto it = index.find({output, mods, code});
+    return it == index.end() ? none : it->second;
+}
+
+const std::vector<wf_binding*>& input_manager::find_activators(
+    wayfire_output *output)
+{
+    static const std::vector<wf_binding*> none;
+
+    auto it = activator_index.find(output);
+    return it == activator_index.end() ? none : it->second;
+}
+
+void input_manager::record_binding_dispatch(
+    std::chrono::steady_clock::time_point start, size_t triggered)
+{
+    using namespace std::chrono;
+    int64_t elapsed = duration_cast<microseconds>(
+        steady_clock::now() - start).count();
+
+    dispatch_stats.events++;
+    dispatch_stats.triggered += triggered;
+    dispatch_stats.total_time += elapsed;
+    dispatch_stats.max_time = std::max(dispatch_stats.max_time, elapsed);
+}
+
+const wf_binding_dispatch_stats& input_manager::get_binding_dispatch_stats() const
+{
+    return dispatch_stats;
+}
+
 void input_manager::rem_binding(wf_binding *binding)
 {
     rem_binding([=] (wf_binding *ptr) { return binding == ptr; });
@@ -2,6 +2,7 @@
 #define INPUT_MANAGER_HPP
 
 #include <unordered_set>
+#include <unordered_map>
 #include <map>
 #include <vector>
 #include <chrono>
@@ -50,6 +51,21 @@ struct wf_binding
         gesture_callback *gesture;
         activator_callback *activator;
     } call;
+
+    /* Re-indexes the binding when its option changes */
+    wf_option_callback value_changed;
+};
+
+/* Statistics about matching key and button events against bindings */
+struct wf_binding_dispatch_stats
+{
+    /* Number of key and button events checked against the bindings */
+    uint64_t events = 0;
+    /* Number of bindings which were triggered */
+    uint64_t triggered = 0;
+    /* Time spent matching the events and calling the bindings, in microseconds */
+    int64_t total_time = 0;
+    int64_t max_time = 0;
 };
 
 using wf_binding_ptr = std::unique_ptr<wf_binding>;
@@ -75,6 +91,57 @@ class input_manager
         using binding_criteria = std::function<bool(wf_binding*)>;
         void rem_binding(binding_criteria criteria);
 
+        /* Key and button bindings are indexed by output, modifiers and
+         * key/button, so that matching an event is a single lookup.
+         * Activators can hold several keys and buttons, so they are indexed
+         * only by output. */
+        struct binding_index_key_t
+        {
+            wayfire_output *output;
+            uint32_t mods;
+            uint32_t code;
+
+            bool operator == (const binding_index_key_t& other) const
+            {
+                return output == other.output && mods == other.mods &&
+                    code == other.code;
+            }
+        };
+
+        struct binding_index_hash_t
+        {
+            size_t operator () (const binding_index_key_t& key) const
+            {
+                size_t hash = std::hash<wayfire_output*>()(key.output);
+                hash = hash * 31 + key.mods;
+                return hash * 31 + key.code;
+            }
+        };
+
+        using binding_index_t = std::unordered_map<binding_index_key_t,
+              std::vector<wf_binding*>, binding_index_hash_t>;
+        binding_index_t key_index, button_index;
+        std::unordered_map<wayfire_output*, std::vector<wf_binding*>> activator_index;
+
+        /* Returns the index and the key the binding is stored under, or null
+         * if bindings of this type aren't indexed */
+        binding_index_t *get_binding_index(wf_binding *binding,
+            binding_index_key_t& key);
+        void index_binding(wf_binding *binding);
+        void unindex_binding(wf_binding *binding);
+        void reindex_bindings();
+
+        /* Returns the indexed bindings for the event, or an empty list */
+        const std::vector<wf_binding*>& find_bindings(binding_index_t& index,
+            wayfire_output *output, uint32_t mods, uint32_t code);
+        const std::vector<wf_binding*>& find_activators(wayfire_output *output);
+
+        wf_binding_dispatch_stats dispatch_stats;
+        /* Add the time since start and the number of triggered bindings to
+         * the dispatch statistics */
+        void record_binding_dispatch(
+            std::chrono::steady_clock::time_point start, size_t triggered);
+
         bool is_touch_enabled();
 
         void create_seat();
@@ -165,6 +232,8 @@ class input_manager
         wf_binding* new_binding(wf_binding_type type, wf_option value, wayfire_output *output, void *callback);
         void rem_binding(void *callback);
         void rem_binding(wf_binding *binding);
+
+        const wf_binding_dispatch_stats& get_binding_dispatch_stats() const;
 };
 
 #endif /* end of include guard: INPUT_MANAGER_HPP */
@@ -173,25 +173,21 @@ std::vector<std::function<void()>> input_manager::match_keys(uint32_t mod_state,
     std::vector<std::function<void()>> callbacks;
 
     uint32_t actual_key = key == 0 ? mod_binding_key : key;
+    auto output = core->get_active_output();
 
-    for (auto& binding : bindings[WF_BINDING_KEY])
+    for (auto binding : find_bindings(key_index, output, mod_state, key))
     {
-        if (binding->value->as_cached_key().matches({mod_state, key}) &&
-            binding->output == core->get_active_output())
-        {
-            /* We must be careful because the callback might be erased,
-             * so force copy the callback into the lambda */
-            auto callback = binding->call.key;
-            callbacks.push_back([actual_key, callback] () {
-                (*callback) (actual_key);
-            });
-        }
+        /* We must be careful because the callback might be erased,
+         * so force copy the callback into the lambda */
+        auto callback = binding->call.key;
+        callbacks.push_back([actual_key, callback] () {
+            (*callback) (actual_key);
+        });
     }
 
-    for (auto& binding : bindings[WF_BINDING_ACTIVATOR])
+    for (auto binding : find_activators(output))
     {
-        if (binding->value->matches_key({mod_state, key}) &&
-            binding->output == core->get_active_output())
+        if (binding->value->matches_key({mod_state, key}))
         {
             /* We must be careful because the callback might be erased,
              * so force copy the callback into the lambda
@@ -221,6 +217,8 @@ bool input_manager::handle_keyboard_key(uint32_t key, uint32_t state)
 
     std::vector<std::function<void()>> callbacks;
     auto kbd = wlr_seat_get_keyboard(seat);
+    auto dispatch_start = steady_clock::now();
+    bool matched = false;
 
     if (state == WLR_KEY_PRESSED)
     {
@@ -248,6 +246,7 @@ bool input_manager::handle_keyboard_key(uint32_t key, uint32_t state)
         }
 
         callbacks = match_keys(get_modifiers(), key);
+        matched = true;
     } else
     {
         if (mod_binding_key != 0)
@@ -259,6 +258,7 @@ bool input_manager::handle_keyboard_key(uint32_t key, uint32_t state)
                     <= milliseconds(timeout))
             {
                 callbacks = match_keys(get_modifiers() | mod, 0, mod_binding_key);
+                matched = true;
             }
         }
 
@@ -268,6 +268,9 @@ bool input_manager::handle_keyboard_key(uint32_t key, uint32_t state)
     for (auto call : callbacks)
         call();
 
+    if (matched)
+        record_binding_dispatch(dispatch_start, callbacks.size());
+
     auto iv = interactive_view_from_view(keyboard_focus.get());
     if (iv) iv->handle_key(key, state);
 
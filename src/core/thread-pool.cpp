@@ -0,0 +1,239 @@
+#include "thread-pool.hpp"
+#include "debug.hpp"
+
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+namespace
+{
+/* The state of a single parallel_for() call. It is shared with the helper
+ * tasks, because a helper might start only after the loop has finished */
+struct loop_job_t
+{
+    std::atomic<int> next;
+    int end, grain;
+    const wf::thread_pool_t::range_func_t *func;
+
+    std::atomic<int> done_ranges{0};
+    int total_ranges;
+
+    std::mutex lock;
+    std::condition_variable finished;
+
+    /* Process ranges until there are none left */
+    void run()
+    {
+        int count = 0;
+        while (true)
+        {
+            int start = next.fetch_add(grain);
+            if (start >= end)
+                break;
+
+            (*func) (start, std::min(start + grain, end));
+            ++count;
+        }
+
+        if (count == 0)
+            return;
+
+        if (done_ranges.fetch_add(count) + count == total_ranges)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            finished.notify_all();
+        }
+    }
+};
+
+int handle_finished_fd(int fd, uint32_t mask, void *data)
+{
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) < 0)
+        log_error("thread pool: failed to read eventfd");
+
+    static_cast<wf::thread_pool_t*> (data)->dispatch_finished();
+    return 0;
+}
+}
+
+wf::thread_pool_t::thread_pool_t(wl_event_loop *loop, int num_workers)
+{
+    if (num_workers <= 0)
+        num_workers = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+
+    finished_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (finished_fd >= 0)
+    {
+        finished_source = wl_event_loop_add_fd(loop, finished_fd,
+            WL_EVENT_READABLE, handle_finished_fd, this);
+    } else
+    {
+        log_error("thread pool: failed to create eventfd, "
+            "async callbacks won't be dispatched");
+    }
+
+    for (int i = 0; i < num_workers; i++)
+        workers.emplace_back([=] () { worker_loop(); });
+
+    log_info("thread pool: started %d workers", num_workers);
+}
+
+wf::thread_pool_t::~thread_pool_t()
+{
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        stopping = true;
+        queue.clear();
+    }
+
+    queue_cond.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+
+    if (finished_source)
+        wl_event_source_remove(finished_source);
+    if (finished_fd >= 0)
+        close(finished_fd);
+}
+
+int wf::thread_pool_t::get_num_workers() const
+{
+    return workers.size();
+}
+
+void wf::thread_pool_t::push_task(task_t task)
+{
+    {
+        std::lock_guard<std::mutex> guard(queue_lock);
+        queue.push_back(std::move(task));
+    }
+
+    queue_cond.notify_one();
+}
+
+void wf::thread_pool_t::worker_loop()
+{
+    while (true)
+    {
+        task_t task;
+        {
+            std::unique_lock<std::mutex> guard(queue_lock);
+            queue_cond.wait(guard, [=] () { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        task();
+    }
+}
+
+void wf::thread_pool_t::parallel_for(int begin, int end, int grain,
+    const range_func_t& func)
+{
+    if (begin >= end)
+        return;
+
+    grain = std::max(grain, 1);
+    int total_ranges = (end - begin + grain - 1) / grain;
+
+    /* Not worth waking up the workers */
+    if (total_ranges == 1 || workers.empty())
+        return func(begin, end);
+
+    auto job = std::make_shared<loop_job_t> ();
+    job->next = begin;
+    job->end = end;
+    job->grain = grain;
+    job->func = &func;
+    job->total_ranges = total_ranges;
+
+    /* The calling thread is one of the helpers */
+    int helpers = std::min(total_ranges - 1, (int)workers.size());
+    for (int i = 0; i < helpers; i++)
+        push_task([job] () { job->run(); });
+
+    job->run();
+
+    std::unique_lock<std::mutex> guard(job->lock);
+    job->finished.wait(guard, [&] () {
+        return job->done_ranges.load() == job->total_ranges;
+    });
+}
+
+void wf::thread_pool_t::run_async(task_t work, task_t done,
+    async_group_t *group)
+{
+    {
+        std::lock_guard<std::mutex> guard(finished_lock);
+        ++async_running;
+        if (group)
+            ++group->running;
+    }
+
+    /* The task drops the functions before reporting that it is done, so
+     * that no code of a plugin runs after wait_async() has returned */
+    push_task([=] () mutable
+    {
+        work();
+        work = nullptr;
+
+        bool has_done = bool(done);
+        {
+            std::lock_guard<std::mutex> guard(finished_lock);
+            if (has_done)
+                finished.emplace_back(group, std::move(done));
+            done = nullptr;
+
+            --async_running;
+            if (group)
+                --group->running;
+            finished_cond.notify_all();
+        }
+
+        if (!has_done)
+            return;
+
+        uint64_t one = 1;
+        if (write(finished_fd, &one, sizeof(one)) < 0)
+            log_error("thread pool: failed to write eventfd");
+    });
+}
+
+void wf::thread_pool_t::wait_async(async_group_t *group)
+{
+    {
+        std::unique_lock<std::mutex> guard(finished_lock);
+        finished_cond.wait(guard, [=] () {
+            return (group ? group->running : async_running) == 0;
+        });
+    }
+
+    dispatch_finished(group);
+}
+
+void wf::thread_pool_t::dispatch_finished(async_group_t *group)
+{
+    std::vector<task_t> callbacks;
+    {
+        std::lock_guard<std::mutex> guard(finished_lock);
+
+        /* Callbacks of other groups stay, the event loop dispatches them */
+        auto it = std::stable_partition(finished.begin(), finished.end(),
+            [=] (const std::pair<async_group_t*, task_t>& entry) {
+                return group && entry.first != group;
+            });
+
+        for (auto i = it; i != finished.end(); ++i)
+            callbacks.push_back(std::move(i->second));
+        finished.erase(it, finished.end());
+    }
+
+    for (auto& callback : callbacks)
+        callback();
+}
@@ -113,19 +113,6 @@ wlr_renderer *add_egl_depth_renderer(wlr_egl *egl, EGLenum platform,
     return renderer;
 }
 
-namespace wf
-{
-    namespace _safe_list_detail
-    {
-        wl_event_loop* event_loop;
-        void idle_cleanup_func(void *data)
-        {
-            auto priv = reinterpret_cast<std::function<void()>*> (data);
-            (*priv)();
-        }
-    }
-}
-
 int main(int argc, char *argv[])
 {
     /*
@@ -151,11 +138,12 @@ int main(int argc, char *argv[])
         { "config",          required_argument, NULL, 'c' },
         { "damage-debug",    no_argument,       NULL, 'd' },
         { "damage-rerender", no_argument,       NULL, 'R' },
+        { "frame-timing",    required_argument, NULL, 'f' },
         { 0,                 0,                 NULL,  0  }
     };
 
     int c, i;
-    while((c = getopt_long(argc, argv, "c:dR", opts, &i)) != -1)
+    while((c = getopt_long(argc, argv, "c:dRf:", opts, &i)) != -1)
     {
         switch(c)
         {
@@ -168,6 +156,11 @@ int main(int argc, char *argv[])
             case 'R':
                 runtime_config.no_damage_track = true;
                 break;
+            case 'f':
+                runtime_config.frame_timing_dump = fopen(optarg, "a");
+                if (!runtime_config.frame_timing_dump)
+                    log_error("failed to open frame timing file %s", optarg);
+                break;
             default:
                 log_error("unrecognized command line argument %s", optarg);
         }
@@ -175,10 +168,7 @@ int main(int argc, char *argv[])
 
     log_info("Starting wayfire");
 
-    /* First create display and initialize safe-list's event loop, so that
-     * wf objects (which depend on safe-list) can work */
     auto display = wl_display_create();
-    wf::_safe_list_detail::event_loop = wl_display_get_event_loop(display);
 
     core = new wayfire_core();
     core->display  = display;
@@ -231,5 +221,8 @@ int main(int argc, char *argv[])
     wl_display_destroy_clients(core->display);
     wl_display_destroy(core->display);
 
+    if (runtime_config.frame_timing_dump)
+        fclose(runtime_config.frame_timing_dump);
+
     return EXIT_SUCCESS;
 }
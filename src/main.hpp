@@ -1,10 +1,14 @@
 #ifndef MAIN_HPP
 #define MAIN_HPP
 
+#include <cstdio>
+
 extern struct wf_runtime_config
 {
     bool no_damage_track = false;
     bool damage_debug = false;
+    /* If set, per-frame timings of all outputs are appended to this file */
+    FILE *frame_timing_dump = nullptr;
 } runtime_config;
 
 #endif /* end of include guard: MAIN_HPP */
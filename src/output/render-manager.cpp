@@ -2,11 +2,15 @@
 #include "output.hpp"
 #include "core.hpp"
 #include "workspace-manager.hpp"
+#include "signal-definitions.hpp"
 #include "../core/seat/input-manager.hpp"
 #include "opengl.hpp"
 #include "debug.hpp"
 #include "../main.hpp"
 #include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <ctime>
 
 extern "C"
 {
@@ -20,6 +24,11 @@ extern "C"
 
 #include "view/priv-view.hpp"
 
+const wf_typed_signal<wf_stream_signal>
+    wf::signals::workspace_stream_pre{"workspace-stream-pre"};
+const wf_typed_signal<wf_stream_signal>
+    wf::signals::workspace_stream_post{"workspace-stream-post"};
+
 struct wf_output_damage
 {
     wf::wl_listener_wrapper on_damage_destroy;
@@ -114,6 +123,57 @@ struct wf_output_damage
     }
 };
 
+int64_t wf_frame_timing::total() const
+{
+    int64_t sum = 0;
+    for (int i = 0; i < WF_FRAME_PHASE_TOTAL; i++)
+        sum += phase_time[i];
+
+    return sum;
+}
+
+constexpr size_t wf_frame_timing_history::capacity;
+void wf_frame_timing_history::push(const wf_frame_timing& timing)
+{
+    timings[head % capacity] = timing;
+    ++head;
+}
+
+std::vector<wf_frame_timing> wf_frame_timing_history::get_timings() const
+{
+    uint64_t end = head;
+    uint64_t begin = end > capacity ? end - capacity : 0;
+
+    std::vector<wf_frame_timing> result;
+    result.reserve(end - begin);
+    for (uint64_t i = begin; i < end; i++)
+        result.push_back(timings[i % capacity]);
+
+    return result;
+}
+
+uint64_t wf_frame_timing_history::get_total_frames() const
+{
+    return head;
+}
+
+/* Returns the current time in microseconds, using CLOCK_MONOTONIC as a base */
+static int64_t get_current_time_us()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ll + ts.tv_nsec / 1000ll;
+}
+
+static int64_t get_region_area(const wf_region& region)
+{
+    int64_t area = 0;
+    for (const auto& rect : region)
+        area += int64_t(rect.x2 - rect.x1) * int64_t(rect.y2 - rect.y1);
+
+    return area;
+}
+
 render_manager::render_manager(wayfire_output *o)
 {
     output = o;
@@ -122,11 +182,61 @@ render_manager::render_manager(wayfire_output *o)
     output_damage = std::unique_ptr<wf_output_damage>(new wf_output_damage(output->handle));
     output_damage->add();
 
-    on_frame.set_callback([&] (void*) { paint(); });
+    on_frame.set_callback([&] (void*) { handle_frame(); });
     on_frame.connect(&output_damage->damage_manager->events.frame);
 
     init_default_streams();
     schedule_redraw();
+
+    background_frame_rate = core->config->get_section("core")
+        ->get_option("background_frame_rate", "1");
+
+    /* Each output may override the default policy in its own section */
+    auto default_render_time = core->config->get_section("core")
+        ->get_option("max_render_time", "-1");
+    max_render_time = core->config->get_section(output->handle->name)
+        ->get_option("max_render_time", default_render_time->as_string());
+
+    background_frame_rate_changed = [=] () { schedule_background_frame_done(); };
+    background_frame_rate->add_updated_handler(&background_frame_rate_changed);
+    schedule_background_frame_done();
+
+    view_detached = [=] (signal_data *data)
+    {
+        auto view = get_signaled_view(data);
+        last_frame_done.erase(view.get());
+        for (auto& row : ws_visibility)
+        {
+            for (auto& ws : row)
+            {
+                ws.visible.erase(view.get());
+                ws.occluded.erase(view.get());
+            }
+        }
+    };
+    output->connect_signal("detach-view", &view_detached);
+
+    /* Moving, resizing, restacking or hiding a view may uncover or cover
+     * other views as well, and the workspaces they are on might not be
+     * repainted soon, so forget everything. Views which haven't been seen by
+     * the occlusion pass are considered visible. */
+    view_stacking_changed = [=] (signal_data*) { reset_visibility(); };
+    output->connect_signal(wf::signals::view_geometry_changed,
+        &view_stacking_changed);
+    output->connect_signal("view-restacked", &view_stacking_changed);
+    output->connect_signal("view-disappeared", &view_stacking_changed);
+}
+
+void render_manager::reset_visibility()
+{
+    for (auto& row : ws_visibility)
+    {
+        for (auto& ws : row)
+        {
+            ws.visible.clear();
+            ws.occluded.clear();
+        }
+    }
 }
 
 void render_manager::init_default_streams()
@@ -134,8 +244,10 @@ void render_manager::init_default_streams()
     /* We use core->vwidth/vheight directly because it is likely workspace_manager
      * hasn't been initialized yet */
     output_streams.resize(core->vwidth);
+    ws_visibility.resize(core->vwidth);
     for (int i = 0; i < core->vwidth; i++)
     {
+        ws_visibility[i].resize(core->vheight);
         for (int j = 0; j < core->vheight; j++)
         {
             output_streams[i].push_back(wf_workspace_stream{});
@@ -147,6 +259,12 @@ void render_manager::init_default_streams()
 
 render_manager::~render_manager()
 {
+    output->disconnect_signal("detach-view", &view_detached);
+    output->disconnect_signal(wf::signals::view_geometry_changed,
+        &view_stacking_changed);
+    output->disconnect_signal("view-restacked", &view_stacking_changed);
+    output->disconnect_signal("view-disappeared", &view_stacking_changed);
+    background_frame_rate->rem_updated_handler(&background_frame_rate_changed);
     for (auto& row : output_streams)
     {
         for (auto& stream : row)
@@ -253,6 +371,12 @@ void render_manager::add_inhibit(bool add)
 }
 
 void render_manager::schedule_redraw()
+{
+    frame_requested = true;
+    schedule_frame();
+}
+
+void render_manager::schedule_frame()
 {
     if (!idle_redraw.is_connected())
     {
@@ -262,6 +386,21 @@ void render_manager::schedule_redraw()
     }
 }
 
+void render_manager::schedule_frames_until(uint32_t deadline)
+{
+    /* Comparison is done on the difference, so that the wraparound of the
+     * millisecond clock doesn't matter */
+    if (!animation_running() || int32_t(deadline - animation_deadline) > 0)
+        animation_deadline = deadline;
+
+    schedule_redraw();
+}
+
+bool render_manager::animation_running()
+{
+    return int32_t(animation_deadline - get_current_time()) > 0;
+}
+
 /* return damage from this frame for the given workspace, coordinates
  * relative to the workspace */
 wf_region render_manager::get_ws_damage(std::tuple<int, int> ws)
@@ -270,6 +409,40 @@ wf_region render_manager::get_ws_damage(std::tuple<int, int> ws)
     return (frame_damage & ws_box) + wf_point{-ws_box.x, -ws_box.y};
 }
 
+std::vector<wf_frame_timing> render_manager::get_frame_timings() const
+{
+    return frame_timings.get_timings();
+}
+
+void render_manager::record_frame_timing(wf_frame_timing& timing)
+{
+    timing.frame_id = frame_timings.get_total_frames();
+    timing.surface_count = frame_surface_count;
+    frame_timings.push(timing);
+
+    /* Follow slower frames immediately, and faster ones over ~32 frames */
+    render_time_estimate = std::max(timing.total(),
+        render_time_estimate - render_time_estimate / 32);
+
+    wf_frame_timing_signal data;
+    data.timing = &timing;
+    emit_signal("frame-timing", &data);
+
+    auto dump = runtime_config.frame_timing_dump;
+    if (!dump)
+        return;
+
+    fprintf(dump, "%s %" PRIu64 " %" PRId64, output->handle->name,
+        timing.frame_id, timing.start);
+    for (int i = 0; i < WF_FRAME_PHASE_TOTAL; i++)
+        fprintf(dump, " %" PRId64, timing.phase_time[i]);
+    fprintf(dump, " %" PRId64 " %u %" PRId64 "\n", timing.damaged_area,
+        timing.surface_count, timing.render_delay);
+
+    /* Make each record visible to tools which follow the file */
+    fflush(dump);
+}
+
 void render_manager::reset_renderer()
 {
     renderer = nullptr;
@@ -281,18 +454,98 @@ void render_manager::set_renderer(render_hook_t rh)
     renderer = rh;
 }
 
+void render_manager::handle_frame()
+{
+    /* The delayed frame hasn't been painted yet, it will pick up everything */
+    if (repaint_pending)
+        return;
+
+    int64_t delay = get_render_delay();
+    if (delay < 1000)
+    {
+        frame_event_time = 0;
+        return paint();
+    }
+
+    frame_event_time = get_current_time_us();
+    repaint_pending = true;
+    repaint_timer.set_timeout(delay / 1000, [=] ()
+    {
+        repaint_pending = false;
+        paint();
+    });
+}
+
+int64_t render_manager::get_render_delay()
+{
+    int max_time = max_render_time->as_cached_int();
+    /* Nested and headless backends have no refresh rate, and if the output
+     * was idle, we don't know when the next vblank is */
+    if (max_time < 0 || output->handle->refresh <= 0 || !last_frame_swapped)
+        return 0;
+
+    /* Refresh is in mHz */
+    int64_t refresh_period = 1000000000ll / output->handle->refresh;
+
+    int64_t render_time;
+    if (max_time > 0)
+    {
+        render_time = max_time * 1000ll;
+    } else
+    {
+        /* Leave some slack for the scheduling of the timer and the commit */
+        const int64_t slack = 1000;
+        render_time = render_time_estimate + slack;
+    }
+
+    return std::max(refresh_period - render_time, (int64_t)0);
+}
+
 void render_manager::paint()
 {
+    wf_frame_timing timing;
+    timing.start = get_current_time_us();
+    if (frame_event_time)
+        timing.render_delay = timing.start - frame_event_time;
+
+    int64_t phase_start = timing.start;
+    auto end_phase = [&] (wf_frame_phase phase)
+    {
+        int64_t now = get_current_time_us();
+        timing.phase_time[phase] = now - phase_start;
+        phase_start = now;
+    };
+
     /* Part 1: frame setup: query damage, etc. */
+    /* Requests made from now on are for the next frame */
+    bool requested = frame_requested;
+    frame_requested = false;
+    animation_frame = animation_running();
+
     frame_damage.clear();
+    frame_surface_count = 0;
     run_effects(effects[WF_OUTPUT_EFFECT_PRE]);
+    end_phase(WF_FRAME_PHASE_PRE_EFFECTS);
 
     bool needs_swap;
     if (!output_damage->make_current(frame_damage, needs_swap))
+    {
+        last_frame_swapped = false;
         return;
+    }
+
+    /* Custom renderers and postprocessing effects repaint the whole output,
+     * so they run on requested frames even if nothing was damaged. Custom
+     * renderers may show any workspace, so damage outside of the visible
+     * area counts for them as well */
+    bool forced_frame = (renderer || post_effects.size()) &&
+        (requested || animation_frame);
+    if (renderer && !frame_damage.empty())
+        forced_frame = true;
 
-    if (!needs_swap && !constant_redraw)
+    if (!needs_swap && !constant_redraw && !forced_frame)
     {
+        last_frame_swapped = false;
         post_paint();
         return;
     }
@@ -307,6 +560,7 @@ void render_manager::paint()
             .allocate(output->handle->width, output->handle->height);
         OpenGL::render_end();
     }
+    end_phase(WF_FRAME_PHASE_MAKE_CURRENT);
 
     wf_region swap_damage;
     if (runtime_config.damage_debug)
@@ -333,9 +587,11 @@ void render_manager::paint()
             default_renderer();
         }
     }
+    end_phase(WF_FRAME_PHASE_RENDER);
 
     /* Part 3: finalize the scene: overlay effects and sw cursors */
     run_effects(effects[WF_OUTPUT_EFFECT_OVERLAY]);
+    end_phase(WF_FRAME_PHASE_OVERLAY);
 
     if (post_effects.size())
         swap_damage |= get_damage_box();
@@ -343,6 +599,7 @@ void render_manager::paint()
     OpenGL::render_begin(get_target_framebuffer());
     wlr_output_render_software_cursors(output->handle, swap_damage.to_pixman());
     OpenGL::render_end();
+    end_phase(WF_FRAME_PHASE_SW_CURSORS);
 
     /* Part 4: postprocessing effects */
     run_post_effects();
@@ -352,11 +609,19 @@ void render_manager::paint()
         OpenGL::clear({0, 0, 0, 1});
         OpenGL::render_end();
     }
+    end_phase(WF_FRAME_PHASE_POST_EFFECTS);
 
     /* Part 5: finalize frame: swap buffers, send frame_done, etc */
+    timing.damaged_area = get_region_area(swap_damage);
     OpenGL::unbind_output(output);
     output_damage->swap_buffers(swap_damage);
+    last_frame_swapped = true;
+    end_phase(WF_FRAME_PHASE_SWAP_BUFFERS);
+
     post_paint();
+    end_phase(WF_FRAME_PHASE_POST_PAINT);
+
+    record_frame_timing(timing);
 }
 
 void render_manager::default_renderer()
@@ -410,41 +675,113 @@ void render_manager::run_post_effects()
     });
 }
 
+bool render_manager::is_view_occluded(wayfire_view_t *view, bool all_workspaces)
+{
+    if (!all_workspaces)
+    {
+        GetTuple(cx, cy, output->workspace->get_current_workspace());
+        return ws_visibility[cx][cy].occluded.count(view);
+    }
+
+    /* With a custom renderer any workspace might be on screen, so a view is
+     * occluded only if it isn't visible on any workspace. Views which haven't
+     * been seen by the occlusion pass are considered visible. */
+    bool seen_occluded = false;
+    for (auto& row : ws_visibility)
+    {
+        for (auto& ws : row)
+        {
+            if (ws.visible.count(view))
+                return false;
+            seen_occluded |= ws.occluded.count(view) > 0;
+        }
+    }
+
+    return seen_occluded;
+}
+
+void render_manager::send_frame_done(wayfire_view view, const timespec& now)
+{
+    if (!view->is_mapped())
+        return;
+
+    last_frame_done[view.get()] = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    view->for_each_surface([&] (wayfire_surface_t *surface, int, int)
+        { surface->send_frame_done(now); });
+}
+
+uint32_t render_manager::get_background_frame_interval()
+{
+    int rate = background_frame_rate->as_cached_int();
+    return rate > 0 ? std::max(1000 / rate, 1) : 1000;
+}
+
+void render_manager::schedule_background_frame_done()
+{
+    /* Hidden views don't get frame-done events at all, so there is no need
+     * to wake up until the option changes */
+    if (background_frame_rate->as_cached_int() <= 0)
+        return background_frame_timer.disconnect();
+
+    background_frame_timer.set_timeout(get_background_frame_interval(),
+        [=] () { send_background_frame_done(); });
+}
+
+void render_manager::send_background_frame_done()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    /* Visible views got their frame-done events in post_paint, so here
+     * we catch only the hidden ones, or all views if the output is idle */
+    uint32_t now_ms = now.tv_sec * 1000 + now.tv_nsec / 1000000;
+    uint32_t interval = get_background_frame_interval();
+    output->workspace->for_each_view([&] (wayfire_view view)
+    {
+        auto it = last_frame_done.find(view.get());
+        if (it == last_frame_done.end() || now_ms - it->second >= interval)
+            send_frame_done(view, now);
+    }, WF_ALL_LAYERS);
+
+    schedule_background_frame_done();
+}
+
 void render_manager::post_paint()
 {
     run_effects(effects[WF_OUTPUT_EFFECT_POST]);
 
-    if (constant_redraw)
-        schedule_redraw();
+    /* The next frame checks both again, it doesn't need to be forced */
+    if (constant_redraw || animation_frame)
+        schedule_frame();
 
-    auto send_frame_done =
-        [=] (wayfire_view v)
-        {
-            if (!v->is_mapped())
-                return;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
 
-            v->for_each_surface([] (wayfire_surface_t *surface, int, int)
-                                {
-                                    struct timespec now;
-                                    clock_gettime(CLOCK_MONOTONIC, &now);
-                                    surface->send_frame_done(now);
-                                });
-        };
+    /* Fully occluded clients don't need to redraw at display rate. Once they
+     * become visible again, the area they occupy is damaged and they will be
+     * repainted and get their frame callbacks. Until then, they and the views
+     * on other workspaces get frame-done events at the background rate */
+    bool all_workspaces = (renderer != nullptr);
+    auto send_visible_frame_done = [&] (wayfire_view v)
+    {
+        if (!is_view_occluded(v.get(), all_workspaces))
+            send_frame_done(v, now);
+    };
 
-    /* TODO: do this only if the view isn't fully occluded by another */
     if (renderer)
     {
-        output->workspace->for_each_view(send_frame_done, WF_VISIBLE_LAYERS);
+        output->workspace->for_each_view(send_visible_frame_done,
+            WF_VISIBLE_LAYERS);
     } else
     {
         auto views = output->workspace->get_views_on_workspace(
             output->workspace->get_current_workspace(), WF_MIDDLE_LAYERS, false);
 
         for (auto v : views)
-            send_frame_done(v);
+            send_visible_frame_done(v);
 
         // send to all panels/backgrounds/etc
-        output->workspace->for_each_view(send_frame_done,
+        output->workspace->for_each_view(send_visible_frame_done,
             WF_BELOW_LAYERS | WF_ABOVE_LAYERS);
     }
 }
@@ -478,14 +815,31 @@ void render_manager::rem_post(post_hook_t *hook)
     damage_whole();
 }
 
-void render_manager::workspace_stream_start(wf_workspace_stream *stream)
+void render_manager::workspace_stream_start(wf_workspace_stream *stream,
+                                            float scale_x, float scale_y)
 {
     stream->running = true;
-    stream->scale_x = stream->scale_y = 1;
 
     /* damage the whole workspace region, so that we get a full repaint */
     frame_damage |= get_ws_box(stream->ws);
-    workspace_stream_update(stream, 1, 1);
+    workspace_stream_update(stream, scale_x, scale_y);
+}
+
+/* Workspace streams are rendered at 1, 1/2, 1/3, ... of the output resolution,
+ * so that they get reallocated and fully repainted only when the requested
+ * scale crosses one of these thresholds, and not on every frame of a zoom
+ * animation. We use a single scale for both axes, so that the framebuffer
+ * keeps the output's aspect ratio and its coordinate conversions. */
+static float get_stream_render_scale(float scale_x, float scale_y)
+{
+    static constexpr int max_divisor = 8;
+
+    float scale = std::max(scale_x, scale_y);
+    if (scale >= 1 || scale <= 0)
+        return 1;
+
+    int divisor = std::floor(1.0 / scale + 1e-3);
+    return 1.0 / std::min(std::max(divisor, 1), max_divisor);
 }
 
 void render_manager::workspace_stream_update(wf_workspace_stream *stream,
@@ -501,40 +855,41 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
 
     wf_region ws_damage = get_ws_damage(stream->ws);
 
-    float current_resolution = stream->scale_x * stream->scale_y;
-    float target_resolution = scale_x * scale_y;
-
-    float scaling = std::max(current_resolution / target_resolution,
-                             target_resolution / current_resolution);
+    /* The default workspace streams are rendered directly to the output */
+    float render_scale = (stream->buffer.fb == 0) ? 1 :
+        get_stream_render_scale(scale_x, scale_y);
 
-    /* TODO: investigate if this still works */
-    if (scaling > 2 && false)
+    if (render_scale != stream->scale_x || render_scale != stream->scale_y)
+    {
+        stream->scale_x = stream->scale_y = render_scale;
+        /* The buffer will be reallocated, so we need a full repaint */
         ws_damage |= get_damage_box();
+    }
 
     /* we don't have to update anything */
     if (ws_damage.empty())
         return;
 
-    if (scale_x != stream->scale_x || scale_y != stream->scale_y)
-    {
-        /* FIXME: enable scaled rendering */
-//        stream->scale_x = scale_x;
-//        stream->scale_y = scale_y;
-
-     //   ws_damage |= get_damage_box();
-    }
-
-
     OpenGL::render_begin();
-    stream->buffer.allocate(output->handle->width, output->handle->height);
+    stream->buffer.allocate(std::ceil(output->handle->width * render_scale),
+        std::ceil(output->handle->height * render_scale));
 
     auto fb = get_target_framebuffer();
     fb.fb = (stream->buffer.fb == 0) ? fb.fb : stream->buffer.fb;
     fb.tex = (stream->buffer.tex == 0) ? fb.tex : stream->buffer.tex;
 
+    if (render_scale != 1)
+    {
+        /* From here on, all damage is in the stream's damage coordinates */
+        fb.scale *= render_scale;
+        fb.viewport_width = stream->buffer.viewport_width;
+        fb.viewport_height = stream->buffer.viewport_height;
+        ws_damage *= render_scale;
+    }
+
     {
         wf_stream_signal data(ws_damage, fb);
-        emit_signal("workspace-stream-pre", &data);
+        emit_signal(wf::signals::workspace_stream_pre, &data);
     }
 
     auto views = output->workspace->get_views_on_workspace(
@@ -548,24 +903,58 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
         wf_region damage;
     };
 
-    using damaged_surface = std::unique_ptr<damaged_surface_t>;
+    std::vector<damaged_surface_t> to_render;
+    to_render.reserve(views.size());
 
-    std::vector<damaged_surface> to_render;
+    /* The part of the workspace which isn't covered by opaque surfaces of the
+     * views above the currently processed view, in workspace-local damage
+     * coordinates. Views which do not intersect it are fully occluded. */
+    wf_region uncovered = fb.get_damage_region();
 
-    const auto schedule_render_snapshotted_view =
-        [&] (wayfire_view view, int view_dx, int view_dy)
+    auto& visibility = ws_visibility[x][y];
+    visibility.visible.clear();
+    visibility.occluded.clear();
+
+    /* Remove the opaque region of the surface at (x, y) from the damage, and
+     * mark it as covered. Surfaces calculate their opaque region in the output's
+     * damage coordinates, so for scaled streams we scale it down and shrink it
+     * by a pixel, to avoid culling partially covered pixels after rounding. */
+    const auto occlude = [&] (wayfire_surface_t *surface, int x, int y)
+    {
+        if (surface->alpha < 0.999f)
+            return;
+
+        if (render_scale == 1)
         {
-            auto ds = damaged_surface(new damaged_surface_t);
+            surface->subtract_opaque(ws_damage, x, y);
+            surface->subtract_opaque(uncovered, x, y);
+            return;
+        }
 
-            auto bbox = view->get_bounding_box() + wf_point{-view_dx, -view_dy};
-            bbox = fb.damage_box_from_geometry_box(bbox);
+        auto obox = surface->get_output_geometry();
+        wf_region surface_region{wlr_box{x, y, obox.width, obox.height}};
+        surface_region *= output->handle->scale;
 
-            ds->damage = ws_damage & bbox;
-            if (!ds->damage.empty())
+        wf_region translucent = surface_region;
+        surface->subtract_opaque(translucent, x, y);
+
+        wf_region opaque = (surface_region ^ translucent) * render_scale;
+        opaque.expand_edges(-1);
+
+        ws_damage ^= opaque;
+        uncovered ^= opaque;
+    };
+
+    const auto schedule_render_snapshotted_view =
+        [&] (wayfire_view view, const wlr_box& bbox, int view_dx, int view_dy)
+        {
+            damaged_surface_t ds;
+            ds.damage = ws_damage & bbox;
+            if (!ds.damage.empty())
             {
-                ds->x = view_dx;
-                ds->y = view_dy;
-                ds->surface = view.get();
+                ds.x = view_dx;
+                ds.y = view_dy;
+                ds.surface = view.get();
 
                 to_render.push_back(std::move(ds));
             }
@@ -577,32 +966,35 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
             if (!surface->is_mapped())
                 return;
 
-            if (ws_damage.empty())
-                return;
-
             /* make sure all coordinates are in workspace-local coords */
             x -= view_dx;
             y -= view_dy;
 
-            auto ds = damaged_surface(new damaged_surface_t);
+            if (ws_damage.empty())
+            {
+                /* Nothing to repaint, just keep track of occlusion */
+                occlude(surface, x, y);
+                return;
+            }
+
+            damaged_surface_t ds;
 
             auto obox = surface->get_output_geometry();
             obox.x = x;
             obox.y = y;
 
             obox = fb.damage_box_from_geometry_box(obox);
-            ds->damage = ws_damage & obox;
-            if (!ds->damage.empty())
+            ds.damage = ws_damage & obox;
+            if (!ds.damage.empty())
             {
-                ds->x = view_dx;
-                ds->y = view_dy;
-                ds->surface = surface;
-
-                if (ds->surface->alpha >= 0.999f)
-                    ds->surface->subtract_opaque(ws_damage, x, y);
-
+                ds.x = view_dx;
+                ds.y = view_dy;
+                ds.surface = surface;
                 to_render.push_back(std::move(ds));
             }
+
+            /* Even if not damaged, it still occludes the views below */
+            occlude(surface, x, y);
         };
 
     /* we "move" all icons to the current output */
@@ -619,21 +1011,38 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
         }
     }
 
-    auto it = views.begin();
-    while (it != views.end() && !ws_damage.empty())
+    /* Front-to-back occlusion pass. Views are culled together with all of
+     * their subsurfaces if their bounding box is fully covered. Transformed
+     * and snapshotted views can only be culled, they never occlude others,
+     * because we don't know what their transformers do with opaque regions. */
+    for (auto& view : views)
     {
-        auto view = *it;
-        int view_dx = 0, view_dy = 0;
-
         if (!view->is_visible())
-            goto next;
+            continue;
+
+        if (uncovered.empty())
+        {
+            visibility.occluded.insert(view.get());
+            continue;
+        }
 
+        int view_dx = 0, view_dy = 0;
         if (view->role != WF_VIEW_ROLE_SHELL_VIEW)
         {
             view_dx = dx;
             view_dy = dy;
         }
 
+        auto bbox = view->get_bounding_box() + wf_point{-view_dx, -view_dy};
+        bbox = fb.damage_box_from_geometry_box(bbox);
+        if ((uncovered & bbox).empty())
+        {
+            visibility.occluded.insert(view.get());
+            continue;
+        }
+
+        visibility.visible.insert(view.get());
+
         /* We use the snapshot of a view if either condition is happening:
          * 1. The view has a transform
          * 2. The view is visible, but not mapped
@@ -642,24 +1051,16 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
         /* Snapshotted views include all of their subsurfaces, so we handle them separately */
         if (view->has_transformer() || !view->is_mapped())
         {
-            schedule_render_snapshotted_view(view, view_dx, view_dy);
-            goto next;
+            if (!ws_damage.empty())
+                schedule_render_snapshotted_view(view, bbox, view_dx, view_dy);
+            continue;
         }
 
         /* Iterate over all subsurfaces/menus of a "regular" view */
         view->for_each_surface([&] (wayfire_surface_t *surface, int x, int y)
         { schedule_render_surface(surface, x, y, view_dx, view_dy); });
+    }
 
-        next: ++it;
-    };
-
-    /*
-     TODO; implement scale != 1
-    glm::mat4 scale = glm::scale(glm::mat4(1.0), glm::vec3(scale_x, scale_y, 1));
-    glm::mat4 translate = glm::translate(glm::mat4(1.0), glm::vec3(scale_x - 1, scale_y - 1, 0));
-    std::swap(wayfire_view_transform::global_scale, scale);
-    std::swap(wayfire_view_transform::global_translate, translate);
-    */
     OpenGL::render_begin(fb);
     for (const auto& rect : ws_damage)
     {
@@ -669,15 +1070,13 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
     }
     OpenGL::render_end();
 
+    frame_surface_count += to_render.size();
     for (auto& ds : wf::reverse(to_render))
     {
-        fb.geometry.x = ds->x; fb.geometry.y = ds->y;
-        ds->surface->render_fb(ds->damage, fb);
+        fb.geometry.x = ds.x; fb.geometry.y = ds.y;
+        ds.surface->render_fb(ds.damage, fb);
     }
 
-   // std::swap(wayfire_view_transform::global_scale, scale);
-   // std::swap(wayfire_view_transform::global_translate, translate);
-
     if (!renderer)
     {
         if (core->input->drag_icon && core->input->drag_icon->is_mapped())
@@ -686,13 +1085,18 @@ void render_manager::workspace_stream_update(wf_workspace_stream *stream,
 
     {
         wf_stream_signal data(ws_damage, fb);
-        emit_signal("workspace-stream-post", &data);
+        emit_signal(wf::signals::workspace_stream_post, &data);
     }
 }
 
 void render_manager::workspace_stream_stop(wf_workspace_stream *stream)
 {
     stream->running = false;
+
+    /* The workspace won't be repainted, so its visibility won't be updated */
+    GetTuple(x, y, stream->ws);
+    ws_visibility[x][y].visible.clear();
+    ws_visibility[x][y].occluded.clear();
 }
 
 /* End render_manager */
@@ -154,6 +154,9 @@ void wf_region::clear()
 
 void wf_region::expand_edges(int amount)
 {
+    if (amount == 0 || empty())
+        return;
+
     /* FIXME: make sure we don't throw pixman errors when amount is bigger
      * than a rectangle size */
     wlr_region_expand(this->to_pixman(), this->to_pixman(), amount);
@@ -164,36 +167,109 @@ pixman_box32_t wf_region::get_extents() const
     return *pixman_region32_extents(this->unconst());
 }
 
+namespace
+{
+/* How a box relates to the extents of a region */
+enum box_relation_t
+{
+    /* The box and the region have no common point */
+    BOX_DISJOINT,
+    /* The box contains the whole region */
+    BOX_COVERS,
+    /* Everything else */
+    BOX_PARTIAL,
+};
+
+box_relation_t get_box_relation(const pixman_box32_t& extents,
+    const pixman_box32_t& box)
+{
+    if (box.x1 >= extents.x2 || extents.x1 >= box.x2 ||
+        box.y1 >= extents.y2 || extents.y1 >= box.y2)
+    {
+        return BOX_DISJOINT;
+    }
+
+    if (box.x1 <= extents.x1 && box.y1 <= extents.y1 &&
+        box.x2 >= extents.x2 && box.y2 >= extents.y2)
+    {
+        return BOX_COVERS;
+    }
+
+    return BOX_PARTIAL;
+}
+
+bool box_is_empty(const pixman_box32_t& box)
+{
+    return box.x1 >= box.x2 || box.y1 >= box.y2;
+}
+
+/* Whether the region consists of exactly one rectangle. Such regions are
+ * stored inline by pixman. */
+bool is_rectangle(pixman_region32_t *region)
+{
+    return pixman_region32_n_rects(region) == 1;
+}
+}
+
 /* Translate the region */
-wf_region wf_region::operator + (const wf_point& vector) const
+wf_region wf_region::operator + (const wf_point& vector) const &
 {
     wf_region result{*this};
-    pixman_region32_translate(&result._region, vector.x, vector.y);
+    result += vector;
     return result;
 }
 
+wf_region wf_region::operator + (const wf_point& vector) &&
+{
+    *this += vector;
+    return std::move(*this);
+}
+
 wf_region& wf_region::operator += (const wf_point& vector)
 {
-    pixman_region32_translate(&_region, vector.x, vector.y);
+    if (vector.x || vector.y)
+        pixman_region32_translate(&_region, vector.x, vector.y);
+
     return *this;
 }
 
-wf_region wf_region::operator * (float scale) const
+wf_region wf_region::operator * (float scale) const &
 {
+    if (scale == 1.0)
+        return *this;
+
     wf_region result;
     wlr_region_scale(result.to_pixman(), this->unconst(), scale);
     return result;
 }
 
+wf_region wf_region::operator * (float scale) &&
+{
+    *this *= scale;
+    return std::move(*this);
+}
+
 wf_region& wf_region::operator *= (float scale)
 {
-    wlr_region_scale(this->to_pixman(), this->to_pixman(), scale);
+    if (scale != 1.0)
+        wlr_region_scale(this->to_pixman(), this->to_pixman(), scale);
+
     return *this;
 }
 
 /* Region intersection */
-wf_region wf_region::operator & (const wlr_box& box) const
+wf_region wf_region::operator & (const wlr_box& box) const &
 {
+    switch (get_box_relation(get_extents(), pixman_box_from_wlr_box(box)))
+    {
+        case BOX_DISJOINT:
+            return {};
+        case BOX_COVERS:
+            return *this;
+        default:
+            break;
+    }
+
     wf_region result;
     pixman_region32_intersect_rect(result.to_pixman(), this->unconst(),
         box.x, box.y, box.width, box.height);
@@ -201,47 +277,123 @@ wf_region wf_region::operator & (const wlr_box& box) const
     return result;
 }
 
-wf_region wf_region::operator & (const wf_region& other) const
+wf_region wf_region::operator & (const wlr_box& box) &&
 {
-    wf_region result;
-    pixman_region32_intersect(result.to_pixman(),
-        this->unconst(), other.unconst());
+    *this &= box;
+    return std::move(*this);
+}
 
+wf_region wf_region::operator & (const wf_region& other) const &
+{
+    wf_region result{*this};
+    result &= other;
     return result;
 }
 
+wf_region wf_region::operator & (const wf_region& other) &&
+{
+    *this &= other;
+    return std::move(*this);
+}
+
 wf_region& wf_region::operator &= (const wlr_box& box)
 {
-    pixman_region32_intersect_rect(this->to_pixman(), this->to_pixman(),
-        box.x, box.y, box.width, box.height);
+    switch (get_box_relation(get_extents(), pixman_box_from_wlr_box(box)))
+    {
+        case BOX_DISJOINT:
+            clear();
+            break;
+        case BOX_COVERS:
+            break;
+        default:
+            pixman_region32_intersect_rect(this->to_pixman(), this->to_pixman(),
+                box.x, box.y, box.width, box.height);
+    }
+
     return *this;
 }
 
 wf_region& wf_region::operator &= (const wf_region& other)
 {
+    auto other_extents = other.get_extents();
+    switch (get_box_relation(get_extents(), other_extents))
+    {
+        case BOX_DISJOINT:
+            clear();
+            return *this;
+        case BOX_COVERS:
+            if (is_rectangle(other.unconst()))
+                return *this;
+            break;
+        default:
+            break;
+    }
+
+    /* A rectangle containing the other region leaves it unchanged */
+    auto extents = get_extents();
+    if (is_rectangle(this->to_pixman()) &&
+        get_box_relation(other_extents, extents) == BOX_COVERS)
+    {
+        return *this = other;
+    }
+
     pixman_region32_intersect(this->to_pixman(),
         this->to_pixman(), other.unconst());
     return *this;
 }
 
 /* Region union */
-wf_region wf_region::operator | (const wlr_box& other) const
+wf_region wf_region::operator | (const wlr_box& other) const &
 {
-    wf_region result;
-    pixman_region32_union_rect(result.to_pixman(), this->unconst(),
-        other.x, other.y, other.width, other.height);
+    wf_region result{*this};
+    result |= other;
     return result;
 }
 
-wf_region wf_region::operator | (const wf_region& other) const
+wf_region wf_region::operator | (const wlr_box& other) &&
+{
+    *this |= other;
+    return std::move(*this);
+}
+
+wf_region wf_region::operator | (const wf_region& other) const &
 {
+    if (other.empty())
+        return *this;
+    if (this->empty())
+        return other;
+
     wf_region result;
     pixman_region32_union(result.to_pixman(), this->unconst(), other.unconst());
     return result;
 }
 
+wf_region wf_region::operator | (const wf_region& other) &&
+{
+    *this |= other;
+    return std::move(*this);
+}
+
 wf_region& wf_region::operator |= (const wlr_box& other)
 {
+    auto box = pixman_box_from_wlr_box(other);
+    if (box_is_empty(box))
+        return *this;
+
+    auto extents = get_extents();
+    /* The result is the box itself, which pixman stores inline */
+    if (empty() || get_box_relation(extents, box) == BOX_COVERS)
+    {
+        pixman_region32_reset(&_region, &box);
+        return *this;
+    }
+
+    if (is_rectangle(&_region) &&
+        get_box_relation(box, extents) == BOX_COVERS)
+    {
+        return *this;
+    }
+
     pixman_region32_union_rect(this->to_pixman(), this->to_pixman(),
         other.x, other.y, other.width, other.height);
     return *this;
@@ -249,37 +401,80 @@ wf_region& wf_region::operator |= (const wlr_box& other)
 
 wf_region& wf_region::operator |= (const wf_region& other)
 {
+    if (other.empty())
+        return *this;
+    if (this->empty())
+        return *this = other;
+
     pixman_region32_union(this->to_pixman(), this->to_pixman(), other.unconst());
     return *this;
 }
 
 /* Subtract the box/region from the current region */
-wf_region wf_region::operator ^ (const wlr_box& box) const
+wf_region wf_region::operator ^ (const wlr_box& box) const &
 {
-    wf_region result;
-    wf_region sub{box};
-    pixman_region32_subtract(result.to_pixman(), this->unconst(), sub.to_pixman());
+    wf_region result{*this};
+    result ^= box;
     return result;
 }
 
-wf_region wf_region::operator ^ (const wf_region& other) const
+wf_region wf_region::operator ^ (const wlr_box& box) &&
 {
-    wf_region result;
-    pixman_region32_subtract(result.to_pixman(),
-        this->unconst(), other.unconst());
+    *this ^= box;
+    return std::move(*this);
+}
+
+wf_region wf_region::operator ^ (const wf_region& other) const &
+{
+    wf_region result{*this};
+    result ^= other;
     return result;
 }
 
+wf_region wf_region::operator ^ (const wf_region& other) &&
+{
+    *this ^= other;
+    return std::move(*this);
+}
+
 wf_region& wf_region::operator ^= (const wlr_box& box)
 {
-    wf_region sub{box};
-    pixman_region32_subtract(this->to_pixman(),
-        this->to_pixman(), sub.to_pixman());
+    switch (get_box_relation(get_extents(), pixman_box_from_wlr_box(box)))
+    {
+        case BOX_DISJOINT:
+            break;
+        case BOX_COVERS:
+            clear();
+            break;
+        default:
+        {
+            pixman_region32_t sub;
+            pixman_region32_init_rect(&sub, box.x, box.y, box.width, box.height);
+            pixman_region32_subtract(this->to_pixman(), this->to_pixman(), &sub);
+            pixman_region32_fini(&sub);
+        }
+    }
+
     return *this;
 }
 
 wf_region& wf_region::operator ^= (const wf_region& other)
 {
+    switch (get_box_relation(get_extents(), other.get_extents()))
+    {
+        case BOX_DISJOINT:
+            return *this;
+        case BOX_COVERS:
+            if (is_rectangle(other.unconst()))
+            {
+                clear();
+                return *this;
+            }
+            break;
+        default:
+            break;
+    }
+
     pixman_region32_subtract(this->to_pixman(),
         this->to_pixman(), other.unconst());
     return *this;
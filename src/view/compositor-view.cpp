@@ -5,6 +5,7 @@
 #include "workspace-manager.hpp"
 #include "compositor-view.hpp"
 #include "debug.hpp"
+#include "signal-definitions.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -152,7 +153,7 @@ wayfire_mirror_view_t::wayfire_mirror_view_t(wayfire_view original_view)
         damage();
     };
 
-    original_view->connect_signal("damaged-region", &base_view_damaged);
+    original_view->connect_signal(wf::signals::damaged_region, &base_view_damaged);
 }
 
 wayfire_mirror_view_t::~wayfire_mirror_view_t()
@@ -241,7 +242,7 @@ wf_geometry wayfire_mirror_view_t::get_untransformed_bounding_box()
 
 void wayfire_mirror_view_t::unset_original_view()
 {
-    original_view->disconnect_signal("damaged-region", &base_view_damaged);
+    original_view->disconnect_signal(wf::signals::damaged_region, &base_view_damaged);
     original_view->disconnect_signal("unmap", &base_view_unmapped);
 
     original_view = nullptr;
@@ -3,6 +3,7 @@ extern "C"
 {
 #define static
 #include <wlr/render/wlr_renderer.h>
+#include <wlr/render/gles2.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/types/wlr_buffer.h>
 #include <wlr/util/region.h>
@@ -123,8 +124,20 @@ void wayfire_surface_t::set_opaque_shrink_constraint(std::string name, int value
 
 void wayfire_surface_t::subtract_opaque(wf_region& region, int x, int y)
 {
-    if (!surface)
+    if (!surface || !pixman_region32_not_empty(&surface->opaque_region))
+        return;
+
+    /* Skip building the scaled opaque region if it can't touch the region */
+    auto extents = *pixman_region32_extents(&surface->opaque_region);
+    auto region_extents = region.get_extents();
+    float scale = output->handle->scale;
+    if ((extents.x2 + x) * scale <= region_extents.x1 ||
+        (extents.x1 + x) * scale >= region_extents.x2 ||
+        (extents.y2 + y) * scale <= region_extents.y1 ||
+        (extents.y1 + y) * scale >= region_extents.y2)
+    {
         return;
+    }
 
     wf_region opaque{&surface->opaque_region};
     opaque += wf_point{x, y};
@@ -335,7 +348,7 @@ void wayfire_surface_t::commit()
     {
         /* we schedule redraw, because the surface might expect
          * a frame callback */
-        output->render->schedule_redraw();
+        output->render->schedule_frame();
     }
 
     buffer_age++;
@@ -429,11 +442,54 @@ void wayfire_surface_t::_wlr_render_box(const wf_framebuffer& fb, int x, int y,
 
 void wayfire_surface_t::simple_render(const wf_framebuffer& fb, int x, int y, const wf_region& damage)
 {
+    /* Regular 2D textures without buffer transform can be rendered with a
+     * single batch for all damaged rectangles. Everything else goes through
+     * wlroots, one rectangle at a time */
+    wlr_gles2_texture_attribs attribs;
+    auto buffer = get_buffer();
+    bool can_batch = buffer && wlr_texture_is_gles2(buffer->texture) &&
+        surface->current.transform == WL_OUTPUT_TRANSFORM_NORMAL;
+
+    if (can_batch)
+    {
+        wlr_gles2_texture_get_attribs(buffer->texture, &attribs);
+        can_batch = attribs.target == GL_TEXTURE_2D;
+    }
+
+    if (!can_batch)
+    {
+        for (const auto& rect : damage)
+        {
+            auto box = wlr_box_from_pixman_box(rect);
+            _wlr_render_box(fb, x, y, fb.framebuffer_box_from_damage_box(box));
+        }
+
+        return;
+    }
+
+    gl_geometry geometry = {
+        1.0f * x + fb.geometry.x, 1.0f * y + fb.geometry.y,
+        1.0f * x + fb.geometry.x + surface->current.width,
+        1.0f * y + fb.geometry.y + surface->current.height,
+    };
+
+    uint32_t bits = attribs.inverted_y ? TEXTURE_TRANSFORM_INVERT_Y : 0;
+    if (!attribs.has_alpha)
+        bits |= TEXTURE_IGNORE_ALPHA;
+
+    OpenGL::render_begin(fb);
+    wf_texture_batch batch(fb);
+    auto projection = fb.get_orthographic_projection();
     for (const auto& rect : damage)
     {
         auto box = wlr_box_from_pixman_box(rect);
-        _wlr_render_box(fb, x, y, fb.framebuffer_box_from_damage_box(box));
+        batch.add_quad(attribs.tex, geometry, {}, projection,
+            {1.0f, 1.0f, 1.0f, alpha}, bits,
+            fb.framebuffer_box_from_damage_box(box));
     }
+
+    batch.flush();
+    OpenGL::render_end();
 }
 
 void wayfire_surface_t::render_fb(const wf_region& damage, const wf_framebuffer& fb)
@@ -23,6 +23,16 @@ wlr_box wf_view_transformer_t::get_bounding_box(wf_geometry view, wlr_box region
     return wlr_box{x1, y1, x2 - x1, y2 - y1};
 }
 
+wf_region wf_view_transformer_t::transform_damage(wf_geometry view,
+    const wf_region& damage)
+{
+    wf_region result;
+    for (const auto& rect : damage)
+        result |= get_bounding_box(view, wlr_box_from_pixman_box(rect));
+
+    return result;
+}
+
 void wf_view_transformer_t::render_with_damage(uint32_t src_tex, wlr_box src_box,
             const wf_region& damage, const wf_framebuffer& target_fb)
 {
@@ -132,8 +142,20 @@ wf_point wf_2D_view::transformed_to_local_point(wf_geometry geometry, wf_point p
                                              {(int32_t) x, (int32_t) y});
 }
 
-void wf_2D_view::render_box(uint32_t src_tex, wlr_box src_box,
-    wlr_box scissor_box, const wf_framebuffer& fb)
+bool wf_2D_view::is_damage_preserving()
+{
+    bool unchanged = last_state.angle == angle &&
+        last_state.scale_x == scale_x && last_state.scale_y == scale_y &&
+        last_state.translation_x == translation_x &&
+        last_state.translation_y == translation_y &&
+        last_state.alpha == alpha;
+
+    last_state = {angle, scale_x, scale_y, translation_x, translation_y, alpha};
+    return unchanged;
+}
+
+void wf_2D_view::get_render_quad(wlr_box src_box, const wf_framebuffer& fb,
+    gl_geometry& geometry, glm::mat4& transform)
 {
     auto quad = center_geometry(fb.geometry, src_box, get_center(view->get_wm_geometry()));
 
@@ -150,11 +172,40 @@ void wf_2D_view::render_box(uint32_t src_tex, wlr_box src_box,
     auto ortho = glm::ortho(-fb.geometry.width  / 2.0f, fb.geometry.width  / 2.0f,
                             -fb.geometry.height / 2.0f, fb.geometry.height / 2.0f);
 
-    auto transform = fb.transform * ortho * translate * rotate;
+    geometry = quad.geometry;
+    transform = fb.transform * ortho * translate * rotate;
+}
+
+void wf_2D_view::render_with_damage(uint32_t src_tex, wlr_box src_box,
+    const wf_region& damage, const wf_framebuffer& fb)
+{
+    gl_geometry geometry;
+    glm::mat4 transform;
+    get_render_quad(src_box, fb, geometry, transform);
+
+    OpenGL::render_begin(fb);
+    wf_texture_batch batch(fb);
+    for (const auto& rect : damage)
+    {
+        batch.add_quad(src_tex, geometry, {}, transform,
+            {1.0f, 1.0f, 1.0f, alpha}, 0,
+            fb.framebuffer_box_from_damage_box(wlr_box_from_pixman_box(rect)));
+    }
+
+    batch.flush();
+    OpenGL::render_end();
+}
+
+void wf_2D_view::render_box(uint32_t src_tex, wlr_box src_box,
+    wlr_box scissor_box, const wf_framebuffer& fb)
+{
+    gl_geometry geometry;
+    glm::mat4 transform;
+    get_render_quad(src_box, fb, geometry, transform);
 
     OpenGL::render_begin(fb);
     fb.scissor(scissor_box);
-    OpenGL::render_transformed_texture(src_tex, quad.geometry, {},
+    OpenGL::render_transformed_texture(src_tex, geometry, {},
                                        transform, {1.0f, 1.0f, 1.0f, alpha});
     OpenGL::render_end();
 }
@@ -205,12 +256,22 @@ wf_point wf_3D_view::transformed_to_local_point(wf_geometry geometry, wf_point p
     return {WF_INVALID_INPUT_COORDINATES, WF_INVALID_INPUT_COORDINATES};
 }
 
-void wf_3D_view::render_box(uint32_t src_tex, wlr_box src_box,
-    wlr_box scissor_box, const wf_framebuffer& fb)
+bool wf_3D_view::is_damage_preserving()
+{
+    auto transform = calculate_total_transform();
+    bool unchanged = (transform == last_transform && color == last_color);
+
+    last_transform = transform;
+    last_color = color;
+    return unchanged;
+}
+
+void wf_3D_view::get_render_quad(wlr_box src_box, const wf_framebuffer& fb,
+    gl_geometry& geometry, glm::mat4& transform)
 {
     auto quad = center_geometry(fb.geometry, src_box, get_center(src_box));
 
-    auto transform = calculate_total_transform();
+    transform = calculate_total_transform();
     auto translate = glm::translate(glm::mat4(1.0), {quad.off_x, quad.off_y, 0});
     auto scale = glm::scale(glm::mat4(1.0), {
                                 2.0 / fb.geometry.width,
@@ -218,11 +279,39 @@ void wf_3D_view::render_box(uint32_t src_tex, wlr_box src_box,
                                 1.0
                             });
 
+    geometry = quad.geometry;
     transform = fb.transform * scale * translate * transform;
+}
+
+void wf_3D_view::render_with_damage(uint32_t src_tex, wlr_box src_box,
+    const wf_region& damage, const wf_framebuffer& fb)
+{
+    gl_geometry geometry;
+    glm::mat4 transform;
+    get_render_quad(src_box, fb, geometry, transform);
+
+    OpenGL::render_begin(fb);
+    wf_texture_batch batch(fb);
+    for (const auto& rect : damage)
+    {
+        batch.add_quad(src_tex, geometry, {}, transform, color, 0,
+            fb.framebuffer_box_from_damage_box(wlr_box_from_pixman_box(rect)));
+    }
+
+    batch.flush();
+    OpenGL::render_end();
+}
+
+void wf_3D_view::render_box(uint32_t src_tex, wlr_box src_box,
+    wlr_box scissor_box, const wf_framebuffer& fb)
+{
+    gl_geometry geometry;
+    glm::mat4 transform;
+    get_render_quad(src_box, fb, geometry, transform);
 
     OpenGL::render_begin(fb);
     fb.scissor(scissor_box);
-    OpenGL::render_transformed_texture(src_tex, quad.geometry, {},
+    OpenGL::render_transformed_texture(src_tex, geometry, {},
                                        transform, color);
     OpenGL::render_end();
 }
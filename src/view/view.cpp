@@ -26,6 +26,13 @@ extern "C"
 #undef static
 }
 
+const wf_typed_signal<view_geometry_changed_signal>
+    wf::signals::view_geometry_changed{"view-geometry-changed"};
+const wf_typed_signal<view_geometry_changed_signal>
+    wf::signals::geometry_changed{"geometry-changed"};
+const wf_typed_signal<signal_data>
+    wf::signals::damaged_region{"damaged-region"};
+
 /* TODO: clean up the code, currently it is a horrible mess
  * Target: split view.cpp into several files, PIMPL the wayfire_view_t and wayfire_surface_t structures */
 
@@ -297,7 +304,9 @@ void wayfire_view_t::move(int x, int y, bool send_signal)
     data.view = self();
     data.old_geometry = wm;
 
-    damage(last_bounding_box);
+    /* Moving doesn't change the contents of the view, so only the output is
+     * damaged, not the snapshot */
+    damage_raw(last_bounding_box);
     geometry.x = x + opos.x - wm.x;
     geometry.y = y + opos.y - wm.y;
 
@@ -309,12 +318,12 @@ void wayfire_view_t::move(int x, int y, bool send_signal)
         offscreen_buffer.geometry.y += y - data.old_geometry.y;
     }
 
-    damage();
+    damage_raw(get_bounding_box());
 
     if (send_signal)
     {
-        output->emit_signal("view-geometry-changed", &data);
-        emit_signal("geometry-changed", &data);
+        output->emit_signal(wf::signals::view_geometry_changed, &data);
+        emit_signal(wf::signals::geometry_changed, &data);
     }
 
     last_bounding_box = get_bounding_box();
@@ -326,15 +335,16 @@ void wayfire_view_t::resize(int w, int h, bool send_signal)
     data.view = self();
     data.old_geometry = get_wm_geometry();
 
-    damage();
+    /* A snapshot with a different size is repainted fully anyway */
+    damage_raw(get_bounding_box());
     geometry.width = w;
     geometry.height = h;
-    damage();
+    damage_raw(get_bounding_box());
 
     if (send_signal)
     {
-        output->emit_signal("view-geometry-changed", &data);
-        emit_signal("geometry-changed", &data);
+        output->emit_signal(wf::signals::view_geometry_changed, &data);
+        emit_signal(wf::signals::geometry_changed, &data);
     }
 }
 
@@ -710,6 +720,9 @@ wf_geometry wayfire_view_t::get_wm_geometry()
 
 void wayfire_view_t::damage_raw(const wlr_box& box)
 {
+    if (!output)
+        return;
+
     auto damage_box = output->render->get_target_framebuffer().
         damage_box_from_geometry_box(box);
 
@@ -739,7 +752,7 @@ void wayfire_view_t::damage_raw(const wlr_box& box)
         output->render->damage(damage_box);
     }
 
-    emit_signal("damaged-region", nullptr);
+    emit_signal(wf::signals::damaged_region, nullptr);
 }
 
 void wayfire_view_t::damage(const wlr_box& box)
@@ -750,11 +763,11 @@ void wayfire_view_t::damage(const wlr_box& box)
     if (!has_transformer())
         return damage_raw(box);
 
-    auto wm_geometry = get_wm_geometry();
+    auto bbox = get_untransformed_bounding_box();
 
     auto real_box = box;
-    real_box.x -= wm_geometry.x;
-    real_box.y -= wm_geometry.y;
+    real_box.x -= bbox.x;
+    real_box.y -= bbox.y;
 
     offscreen_buffer.cached_damage |= real_box;
     damage_raw(transform_region(box));
@@ -778,34 +791,68 @@ void wayfire_view_t::take_snapshot()
     auto buffer_geometry = get_untransformed_bounding_box();
     offscreen_buffer.geometry = buffer_geometry;
 
+    /* The position of the view's main surface in the snapshot. If it changes,
+     * the contents of the whole snapshot are shifted */
+    auto main_geometry = get_output_geometry();
+    wf_point main_offset = {main_geometry.x - buffer_geometry.x,
+        main_geometry.y - buffer_geometry.y};
+
     float scale = output->handle->scale;
     if (int(buffer_geometry.width  * scale) != offscreen_buffer.viewport_width ||
         int(buffer_geometry.height * scale) != offscreen_buffer.viewport_height ||
-        offscreen_buffer.scale != scale)
+        offscreen_buffer.scale != scale ||
+        main_offset.x != offscreen_buffer.main_offset.x ||
+        main_offset.y != offscreen_buffer.main_offset.y)
     {
         // scale/size changed, invalidate offscreen buffer
         last_offscreen_buffer_age = -1;
     }
 
-    /* Nothing has changed, the last buffer is still valid */
-    if (buffer_age <= last_offscreen_buffer_age)
+    /* Nothing has changed, the last buffer is still valid. Damage without a
+     * new buffer, for example from decorations, must still be repainted */
+    if (buffer_age <= last_offscreen_buffer_age &&
+        offscreen_buffer.cached_damage.empty())
+    {
         return;
-
-    last_offscreen_buffer_age = buffer_age;
+    }
 
     OpenGL::render_begin();
-    offscreen_buffer.allocate(buffer_geometry.width * scale, buffer_geometry.height * scale);
-    offscreen_buffer.scale = scale;
-    offscreen_buffer.bind();
-    OpenGL::clear({0, 0, 0, 0});
+    bool reallocated = offscreen_buffer.allocate(
+        buffer_geometry.width * scale, buffer_geometry.height * scale);
     OpenGL::render_end();
 
+    offscreen_buffer.scale = scale;
+    offscreen_buffer.main_offset = main_offset;
+
     wf_region full_region{{0, 0, offscreen_buffer.viewport_width,
         offscreen_buffer.viewport_height}};
-    for_each_surface([=] (wayfire_surface_t *surface, int x, int y)
+
+    /* Repaint only the damaged parts, unless the old contents are invalid */
+    wf_region repaint_region = full_region;
+    if (last_offscreen_buffer_age >= 0 && !reallocated)
+        repaint_region &= offscreen_buffer.cached_damage * scale;
+
+    offscreen_buffer.cached_damage.clear();
+    last_offscreen_buffer_age = buffer_age;
+
+    if (repaint_region.empty())
+        return;
+
+    offscreen_buffer.changed_region |= repaint_region * (1.0 / scale);
+
+    OpenGL::render_begin(offscreen_buffer);
+    for (const auto& rect : repaint_region)
+    {
+        offscreen_buffer.scissor(offscreen_buffer.framebuffer_box_from_damage_box(
+                wlr_box_from_pixman_box(rect)));
+        OpenGL::clear({0, 0, 0, 0});
+    }
+    OpenGL::render_end();
+
+    for_each_surface([&] (wayfire_surface_t *surface, int x, int y)
     {
         surface->simple_render(offscreen_buffer,
-            x - buffer_geometry.x, y - buffer_geometry.y, full_region);
+            x - buffer_geometry.x, y - buffer_geometry.y, repaint_region);
     }, true);
 }
 
@@ -835,6 +882,12 @@ void wayfire_view_t::render_fb(const wf_region& damaged_region, const wf_framebu
     /* final_transform is the one that should render to the screen */
     std::shared_ptr<transform_t> final_transform = nullptr;
 
+    /* The part of the input of the current transform which has changed since
+     * the last time it was rendered, in output-local coordinates */
+    wf_region input_damage = offscreen_buffer.changed_region +
+        wf_point{obox.x, obox.y};
+    offscreen_buffer.changed_region.clear();
+
     transforms.for_each([&] (auto& transform) -> void
     {
         /* Last transform is handled separately */
@@ -847,19 +900,46 @@ void wayfire_view_t::render_fb(const wf_region& damaged_region, const wf_framebu
         /* Calculate size after this transform */
         auto transformed_box = transform->transform->get_bounding_box(obox, obox);
 
-        /* Prepare buffer to store result after the transform */
-        OpenGL::render_begin();
-        transform->fb.allocate(transformed_box.width, transformed_box.height);
-        transform->fb.geometry = transformed_box;
-        transform->fb.bind(); // bind buffer to clear
-        OpenGL::clear({0, 0, 0, 0});
-        OpenGL::render_end();
+        /* The result of the last frame can be reused, if the transformer
+         * hasn't changed and the input is still at the same place */
+        bool preserving = transform->transform->is_damage_preserving();
+        bool reuse = preserving && transform->fb.tex != (uint32_t)-1 &&
+            transform->input_box == obox &&
+            transform->fb.geometry == transformed_box;
+        transform->input_box = obox;
+
+        if (reuse)
+        {
+            input_damage = transform->transform->transform_damage(obox,
+                input_damage) & transformed_box;
+        } else
+        {
+            OpenGL::render_begin();
+            transform->fb.allocate(transformed_box.width, transformed_box.height);
+            transform->fb.geometry = transformed_box;
+            OpenGL::render_end();
+
+            input_damage = transformed_box;
+        }
 
         /* Actually render the transform to the next framebuffer */
-        wf_region whole_region{wlr_box{0, 0,
-            transformed_box.width, transformed_box.height}};
-        transform->transform->render_with_damage(previous_texture, obox,
-            whole_region, transform->fb);
+        wf_region repaint_region = input_damage +
+            wf_point{-transformed_box.x, -transformed_box.y};
+
+        if (!repaint_region.empty())
+        {
+            OpenGL::render_begin(transform->fb);
+            for (const auto& rect : repaint_region)
+            {
+                transform->fb.scissor(transform->fb.framebuffer_box_from_damage_box(
+                        wlr_box_from_pixman_box(rect)));
+                OpenGL::clear({0, 0, 0, 0});
+            }
+            OpenGL::render_end();
+
+            transform->transform->render_with_damage(previous_texture, obox,
+                repaint_region, transform->fb);
+        }
 
         previous_transform = transform;
         previous_texture = previous_transform->fb.tex;
@@ -903,6 +983,11 @@ wayfire_view_t::transform_t::~transform_t()
 
 void wayfire_view_t::add_transformer(std::unique_ptr<wf_view_transformer_t> transformer, std::string name)
 {
+    /* Damage isn't tracked in the snapshot while there are no transformers,
+     * so its old contents can't be partially repainted anymore */
+    if (!has_transformer())
+        last_offscreen_buffer_age = -1;
+
     damage();
     auto tr = std::make_shared<transform_t> ();
     tr->transform = std::move(transformer);
@@ -1053,6 +1138,7 @@ void emit_view_unmap(wayfire_view view)
 void wayfire_view_t::unmap()
 {
     _is_mapped = false;
+    last_offscreen_buffer_age = -1;
     destroy_toplevel();
 
     if (parent)
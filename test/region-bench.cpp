@@ -0,0 +1,151 @@
+/* Measures the region operations which run on the hot path of the renderer,
+ * once with wf_region and once with plain pixman calls, which is how they
+ * were done before wf_region got its fast paths. */
+#include <util.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+static const int iterations = 200000;
+
+static void measure(const char *name, std::function<void()> wf,
+    std::function<void()> pixman)
+{
+    auto run = [] (std::function<void()>& func)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            func();
+        auto end = std::chrono::steady_clock::now();
+
+        return std::chrono::duration<double, std::nano>(end - start).count()
+            / iterations;
+    };
+
+    double wf_ns = run(wf), pixman_ns = run(pixman);
+    std::printf("%-28s wf_region %8.1f ns   pixman %8.1f ns   %.2fx\n",
+        name, wf_ns, pixman_ns, pixman_ns / wf_ns);
+}
+
+int main()
+{
+    std::mt19937 rng(7);
+
+    /* Damage from many small clients */
+    std::vector<wlr_box> boxes;
+    for (int i = 0; i < 8; i++)
+    {
+        boxes.push_back({int(rng() % 1800), int(rng() % 1000),
+            20 + int(rng() % 100), 20 + int(rng() % 60)});
+    }
+
+    const wlr_box ws_box = {0, 0, 1920, 1080};
+    const wlr_box view_box = {300, 200, 800, 600};
+    const wlr_box opaque_box = {310, 230, 780, 560};
+
+    wf_region damage;
+    pixman_region32_t pixman_damage;
+    pixman_region32_init(&pixman_damage);
+    for (auto& box : boxes)
+    {
+        damage |= box;
+        pixman_region32_union_rect(&pixman_damage, &pixman_damage,
+            box.x, box.y, box.width, box.height);
+    }
+
+    volatile bool sink;
+    measure("union of small boxes", [&] ()
+    {
+        wf_region region;
+        for (auto& box : boxes)
+            region |= box;
+        sink = region.empty();
+    }, [&] ()
+    {
+        pixman_region32_t region;
+        pixman_region32_init(&region);
+        for (auto& box : boxes)
+        {
+            pixman_region32_union_rect(&region, &region,
+                box.x, box.y, box.width, box.height);
+        }
+
+        sink = pixman_region32_not_empty(&region);
+        pixman_region32_fini(&region);
+    });
+
+    measure("(damage & ws) + offset", [&] ()
+    {
+        auto region = (damage & ws_box) + wf_point{-1920, 0};
+        sink = region.empty();
+    }, [&] ()
+    {
+        pixman_region32_t region;
+        pixman_region32_init(&region);
+        pixman_region32_intersect_rect(&region, &pixman_damage,
+            ws_box.x, ws_box.y, ws_box.width, ws_box.height);
+        pixman_region32_translate(&region, -1920, 0);
+        sink = pixman_region32_not_empty(&region);
+        pixman_region32_fini(&region);
+    });
+
+    measure("full damage & view box", [&] ()
+    {
+        wf_region full{ws_box};
+        auto region = full & view_box;
+        sink = region.empty();
+    }, [&] ()
+    {
+        pixman_region32_t full, region;
+        pixman_region32_init_rect(&full,
+            ws_box.x, ws_box.y, ws_box.width, ws_box.height);
+        pixman_region32_init(&region);
+        pixman_region32_intersect_rect(&region, &full,
+            view_box.x, view_box.y, view_box.width, view_box.height);
+        sink = pixman_region32_not_empty(&region);
+        pixman_region32_fini(&region);
+        pixman_region32_fini(&full);
+    });
+
+    measure("subtract opaque region", [&] ()
+    {
+        wf_region region{ws_box};
+        region ^= opaque_box;
+        sink = region.empty();
+    }, [&] ()
+    {
+        pixman_region32_t region, opaque;
+        pixman_region32_init_rect(&region,
+            ws_box.x, ws_box.y, ws_box.width, ws_box.height);
+        pixman_region32_init_rect(&opaque, opaque_box.x, opaque_box.y,
+            opaque_box.width, opaque_box.height);
+        pixman_region32_subtract(&region, &region, &opaque);
+        sink = pixman_region32_not_empty(&region);
+        pixman_region32_fini(&opaque);
+        pixman_region32_fini(&region);
+    });
+
+    measure("disjoint boxes", [&] ()
+    {
+        wf_region region{boxes[0]};
+        auto result = region & wlr_box{-200, -200, 10, 10};
+        sink = result.empty();
+    }, [&] ()
+    {
+        pixman_region32_t region, result;
+        pixman_region32_init_rect(&region, boxes[0].x, boxes[0].y,
+            boxes[0].width, boxes[0].height);
+        pixman_region32_init(&result);
+        pixman_region32_intersect_rect(&result, &region, -200, -200, 10, 10);
+        sink = pixman_region32_not_empty(&result);
+        pixman_region32_fini(&result);
+        pixman_region32_fini(&region);
+    });
+
+    (void)sink;
+    pixman_region32_fini(&pixman_damage);
+    return 0;
+}
@@ -0,0 +1,167 @@
+/* Compares the results of all wf_region operations with a model which
+ * represents regions as sets of pixels, on random regions and boxes. */
+#include <util.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <set>
+
+using pixel_set_t = std::set<std::pair<int, int>>;
+
+static std::mt19937 rng(7);
+
+static pixel_set_t get_pixels(const wlr_box& box)
+{
+    pixel_set_t result;
+    for (int x = box.x; x < box.x + box.width; x++)
+    {
+        for (int y = box.y; y < box.y + box.height; y++)
+            result.insert({x, y});
+    }
+
+    return result;
+}
+
+static pixel_set_t get_pixels(const wf_region& region)
+{
+    pixel_set_t result;
+    for (const auto& box : region)
+    {
+        auto pixels = get_pixels(wlr_box_from_pixman_box(box));
+        result.insert(pixels.begin(), pixels.end());
+    }
+
+    return result;
+}
+
+static pixel_set_t intersect(const pixel_set_t& a, const pixel_set_t& b)
+{
+    pixel_set_t result;
+    for (auto& p : a)
+    {
+        if (b.count(p))
+            result.insert(p);
+    }
+
+    return result;
+}
+
+static pixel_set_t unite(pixel_set_t a, const pixel_set_t& b)
+{
+    a.insert(b.begin(), b.end());
+    return a;
+}
+
+static pixel_set_t subtract(const pixel_set_t& a, const pixel_set_t& b)
+{
+    pixel_set_t result;
+    for (auto& p : a)
+    {
+        if (!b.count(p))
+            result.insert(p);
+    }
+
+    return result;
+}
+
+static pixel_set_t translate(const pixel_set_t& a, wf_point vector)
+{
+    pixel_set_t result;
+    for (auto& p : a)
+        result.insert({p.first + vector.x, p.second + vector.y});
+
+    return result;
+}
+
+/* Small boxes on a small grid, so that the boxes often touch, overlap or
+ * contain each other, which is where the fast paths kick in. Some of them
+ * are empty. */
+static wlr_box random_box()
+{
+    int x = int(rng() % 12) - 2;
+    int y = int(rng() % 12) - 2;
+    if (rng() % 8 == 0)
+        return {x, y, 0, int(rng() % 4)};
+
+    return {x, y, 1 + int(rng() % 8), 1 + int(rng() % 8)};
+}
+
+static wf_region random_region()
+{
+    wf_region result;
+    int count = rng() % 5;
+    for (int i = 0; i < count; i++)
+        result |= random_box();
+
+    return result;
+}
+
+int main()
+{
+    for (int i = 0; i < 20000; i++)
+    {
+        auto a = random_region(), b = random_region();
+        auto box = random_box();
+        auto pa = get_pixels(a), pb = get_pixels(b), pbox = get_pixels(box);
+
+        /* Copying operators */
+        assert(get_pixels(a & box) == intersect(pa, pbox));
+        assert(get_pixels(a & b) == intersect(pa, pb));
+        assert(get_pixels(a | box) == unite(pa, pbox));
+        assert(get_pixels(a | b) == unite(pa, pb));
+        assert(get_pixels(a ^ box) == subtract(pa, pbox));
+        assert(get_pixels(a ^ b) == subtract(pa, pb));
+
+        /* Operators on temporaries, which reuse the storage of the left side */
+        assert(get_pixels(wf_region{a} & box) == intersect(pa, pbox));
+        assert(get_pixels(wf_region{a} & b) == intersect(pa, pb));
+        assert(get_pixels(wf_region{a} | box) == unite(pa, pbox));
+        assert(get_pixels(wf_region{a} | b) == unite(pa, pb));
+        assert(get_pixels(wf_region{a} ^ box) == subtract(pa, pbox));
+        assert(get_pixels(wf_region{a} ^ b) == subtract(pa, pb));
+
+        /* In-place operators */
+        auto c = a;
+        c &= box;
+        assert(get_pixels(c) == intersect(pa, pbox));
+        c = a;
+        c &= b;
+        assert(get_pixels(c) == intersect(pa, pb));
+        c = a;
+        c |= box;
+        assert(get_pixels(c) == unite(pa, pbox));
+        c = a;
+        c |= b;
+        assert(get_pixels(c) == unite(pa, pb));
+        c = a;
+        c ^= box;
+        assert(get_pixels(c) == subtract(pa, pbox));
+        c = a;
+        c ^= b;
+        assert(get_pixels(c) == subtract(pa, pb));
+
+        /* An operand aliasing the result */
+        c = a;
+        c |= c;
+        assert(get_pixels(c) == pa);
+        c &= c;
+        assert(get_pixels(c) == pa);
+        c ^= c;
+        assert(c.empty());
+
+        wf_point offset = {int(rng() % 7) - 3, int(rng() % 7) - 3};
+        assert(get_pixels((a & box) + offset) ==
+            translate(intersect(pa, pbox), offset));
+        c = a;
+        c += offset;
+        assert(get_pixels(c) == translate(pa, offset));
+        assert(get_pixels(a * 1.0) == pa);
+
+        assert(a.empty() == pa.empty());
+        assert((a & b).empty() == intersect(pa, pb).empty());
+    }
+
+    std::printf("region: ok\n");
+    return 0;
+}
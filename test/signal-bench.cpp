@@ -0,0 +1,99 @@
+/* Measures the cost of emitting a signal with the typed and the string API,
+ * and with the string-keyed implementation which they replaced. */
+#include <object.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/* The previous wf_signal_provider_t: the name is hashed on each emit (and an
+ * empty entry is created for signals without listeners), and the listeners
+ * are heap-allocated nodes of a std::list iterated through a std::function */
+class legacy_signal_provider_t
+{
+    public:
+    void connect_signal(std::string name, signal_callback_t* callback)
+    {
+        signals[name].push_back(std::make_unique<signal_callback_t*>(callback));
+    }
+
+    void emit_signal(std::string name, signal_data *data)
+    {
+        for_each(signals[name], [data] (signal_callback_t *call) {
+            (*call) (data);
+        });
+    }
+
+    private:
+    using list_t = std::list<std::unique_ptr<signal_callback_t*>>;
+    static void for_each(const list_t& list,
+        std::function<void(signal_callback_t*)> func)
+    {
+        for (auto& el : list)
+        {
+            if (el)
+                func(*el);
+        }
+    }
+
+    std::unordered_map<std::string, list_t> signals;
+};
+
+static const wf_typed_signal<signal_data> damaged_signal{"damaged-region"};
+static const int iterations = 2000000;
+
+template<class Func> static double measure(Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        func();
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::nano>(end - start).count()
+        / iterations;
+}
+
+int main()
+{
+    volatile int counter = 0;
+    signal_callback_t callback = [&] (signal_data*) { counter = counter + 1; };
+
+    for (int listeners : {0, 1, 4})
+    {
+        wf_signal_provider_t provider;
+        legacy_signal_provider_t legacy;
+
+        /* Other signals on the same object */
+        for (auto name : {"geometry-changed", "title-changed", "unmap-view"})
+        {
+            provider.connect_signal(name, &callback);
+            legacy.connect_signal(name, &callback);
+        }
+
+        for (int i = 0; i < listeners; i++)
+        {
+            provider.connect_signal(damaged_signal, &callback);
+            legacy.connect_signal("damaged-region", &callback);
+        }
+
+        signal_data data;
+        double typed = measure([&] {
+            provider.emit_signal(damaged_signal, &data);
+        });
+        double by_name = measure([&] {
+            provider.emit_signal("damaged-region", &data);
+        });
+        double old = measure([&] {
+            legacy.emit_signal("damaged-region", &data);
+        });
+
+        std::printf("%d listeners: typed %6.1f ns   string %6.1f ns   "
+            "legacy %6.1f ns\n", listeners, typed, by_name, old);
+    }
+
+    return 0;
+}
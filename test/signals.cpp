@@ -0,0 +1,66 @@
+/* Checks connecting, disconnecting and emitting signals, including changes to
+ * the listeners from inside a callback and nested emits. */
+#include <object.hpp>
+
+#include <cassert>
+#include <cstdio>
+
+static const wf_typed_signal<signal_data> typed_signal{"typed-signal"};
+
+int main()
+{
+    wf_signal_provider_t provider;
+
+    /* Emitting or disconnecting a signal which nobody connected to doesn't
+     * intern its name */
+    signal_callback_t unused = [] (signal_data*) {};
+    provider.emit_signal("never-connected", nullptr);
+    provider.disconnect_signal("never-connected", &unused);
+    assert(!wf_signal_id::find("never-connected").valid());
+
+    assert(wf_signal_id("test").get_index() ==
+        wf_signal_id::find("test").get_index());
+    assert(wf_signal_id("test").get_name() == "test");
+
+    /* a disconnects b and connects c, c disconnects a and itself and emits
+     * the same signal again */
+    int a = 0, b = 0, c = 0;
+    signal_callback_t callback_a, callback_b, callback_c;
+    callback_a = [&] (signal_data*)
+    {
+        ++a;
+        provider.disconnect_signal("test", &callback_b);
+        provider.connect_signal("test", &callback_c);
+    };
+    callback_b = [&] (signal_data*) { ++b; };
+    callback_c = [&] (signal_data*)
+    {
+        ++c;
+        provider.disconnect_signal("test", &callback_c);
+        provider.disconnect_signal("test", &callback_a);
+        provider.emit_signal("test", nullptr);
+    };
+
+    provider.connect_signal("test", &callback_a);
+    provider.connect_signal("test", &callback_b);
+    provider.emit_signal("test", nullptr);
+    /* b was disconnected before it was reached, c was added during the emit
+     * and is run by it, and its nested emit has no listeners left */
+    assert(a == 1 && b == 0 && c == 1);
+
+    provider.emit_signal("test", nullptr);
+    assert(a == 1 && b == 0 && c == 1);
+
+    /* Typed and string variants refer to the same signal */
+    int typed = 0;
+    signal_callback_t callback_typed = [&] (signal_data*) { ++typed; };
+    provider.connect_signal("typed-signal", &callback_typed);
+    provider.emit_signal(typed_signal, nullptr);
+    provider.emit_signal("typed-signal", nullptr);
+    provider.disconnect_signal(typed_signal, &callback_typed);
+    provider.emit_signal("typed-signal", nullptr);
+    assert(typed == 2);
+
+    std::printf("signals: ok\n");
+    return 0;
+}
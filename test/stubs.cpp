@@ -0,0 +1,11 @@
+/* Symbols which are normally provided by main.cpp and core.cpp. The tests
+ * link only the parts of wayfire they exercise, so they define them here. */
+#include <debug.hpp>
+#include <core.hpp>
+
+wayfire_core *core = nullptr;
+
+const char *wf_strip_path(const char *path)
+{
+    return path;
+}
@@ -0,0 +1,79 @@
+/* Compares the window-rules Aho-Corasick matcher with std::string::find on
+ * random patterns and texts. Small alphabets make patterns which overlap,
+ * repeat and are suffixes of each other common. */
+#include "../plugins/single_plugins/substring-matcher.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <random>
+
+static std::mt19937 rng(42);
+
+static std::string random_string(int max_length, int alphabet)
+{
+    std::string result;
+    int length = rng() % (max_length + 1);
+    for (int i = 0; i < length; i++)
+        result += char('a' + rng() % alphabet);
+
+    return result;
+}
+
+/* The number of (possibly overlapping) occurrences of pattern in text */
+static int count_occurrences(const std::string& text, const std::string& pattern)
+{
+    int count = 0;
+    for (size_t pos = text.find(pattern); pos != std::string::npos;
+         pos = text.find(pattern, pos + 1))
+    {
+        ++count;
+    }
+
+    return count;
+}
+
+int main()
+{
+    for (int i = 0; i < 20000; i++)
+    {
+        int alphabet = 1 + rng() % 4;
+        int count = 1 + rng() % 8;
+
+        substring_matcher_t matcher;
+        std::vector<std::string> patterns;
+        for (int j = 0; j < count; j++)
+        {
+            auto pattern = random_string(5, alphabet);
+            if (pattern.empty())
+                pattern = "a";
+
+            patterns.push_back(pattern);
+            matcher.add(pattern, j);
+        }
+
+        matcher.build();
+
+        for (int t = 0; t < 10; t++)
+        {
+            auto text = random_string(20, alphabet);
+
+            std::vector<int> found;
+            matcher.find_all(text, found);
+            std::sort(found.begin(), found.end());
+
+            /* Each pattern is reported once per occurrence */
+            std::vector<int> expected;
+            for (int j = 0; j < count; j++)
+            {
+                expected.insert(expected.end(),
+                    count_occurrences(text, patterns[j]), j);
+            }
+
+            assert(found == expected);
+        }
+    }
+
+    std::printf("substring-matcher: ok\n");
+    return 0;
+}
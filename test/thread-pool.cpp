@@ -0,0 +1,113 @@
+/* Checks that parallel_for processes every element exactly once, and that
+ * the done callbacks of run_async() are dispatched on the main thread, from
+ * the event loop or from wait_async() of their group. */
+#include <thread-pool.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+static void check_parallel_for()
+{
+    for (int workers : {1, 3, 8})
+    {
+        wl_event_loop *loop = wl_event_loop_create();
+        auto pool = std::make_unique<wf::thread_pool_t> (loop, workers);
+
+        for (int count : {0, 1, 2, 7, 100, 1000, 100003})
+        {
+            for (int grain : {0, 1, 3, 64, 200000})
+            {
+                for (int begin : {0, -5, 17})
+                {
+                    std::vector<std::atomic<int>> hits(count);
+                    for (auto& hit : hits)
+                        hit = 0;
+
+                    int end = begin + count;
+                    pool->parallel_for(begin, end, grain, [&] (int b, int e)
+                    {
+                        assert(begin <= b && b < e && e <= end);
+                        assert(e - b <= std::max(grain, 1));
+                        for (int i = b; i < e; i++)
+                            ++hits[i - begin];
+                    });
+
+                    for (auto& hit : hits)
+                        assert(hit == 1);
+                }
+            }
+        }
+
+        pool.reset();
+        wl_event_loop_destroy(loop);
+    }
+}
+
+static void check_async()
+{
+    using namespace std::chrono;
+
+    wl_event_loop *loop = wl_event_loop_create();
+    auto main_thread = std::this_thread::get_id();
+
+    {
+        wf::thread_pool_t pool(loop, 4);
+        wf::thread_pool_t::async_group_t short_tasks, long_task;
+
+        std::atomic<int> work_done{0};
+        int short_done = 0, long_done = 0;
+        for (int i = 0; i < 8; i++)
+        {
+            pool.run_async([&] ()
+            {
+                assert(std::this_thread::get_id() != main_thread);
+                std::this_thread::sleep_for(milliseconds(10));
+                ++work_done;
+            }, [&] ()
+            {
+                assert(std::this_thread::get_id() == main_thread);
+                ++short_done;
+            }, &short_tasks);
+        }
+
+        std::atomic<bool> release_long{false};
+        pool.run_async([&] ()
+        {
+            while (!release_long)
+                std::this_thread::sleep_for(milliseconds(1));
+        }, [&] () { ++long_done; }, &long_task);
+
+        /* A task without a done callback */
+        pool.run_async([&] () { ++work_done; });
+
+        /* Waiting for a group doesn't wait for the other groups, and runs only
+         * the callbacks of the group */
+        pool.wait_async(&short_tasks);
+        assert(short_done == 8 && long_done == 0);
+
+        /* The other callbacks are dispatched from the event loop */
+        release_long = true;
+        auto deadline = steady_clock::now() + seconds(10);
+        while (long_done == 0 && steady_clock::now() < deadline)
+            wl_event_loop_dispatch(loop, 100);
+        assert(long_done == 1);
+
+        pool.wait_async();
+        assert(work_done == 9 && short_done == 8 && long_done == 1);
+    }
+
+    wl_event_loop_destroy(loop);
+}
+
+int main()
+{
+    check_parallel_for();
+    check_async();
+
+    std::printf("thread-pool: ok\n");
+    return 0;
+}